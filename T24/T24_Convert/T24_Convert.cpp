@@ -0,0 +1,82 @@
+#include <iostream>
+#include <filesystem>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Error.h"
+#include "Config.h"
+#include "ResultFile.h"
+#include "TextOutput.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+/*
+* Regenerate the text output files (fpt, e_, summary, srm, crd, cop)
+* from binary result files written by T24_CPP with output_format=binary.
+* Usage: T24_Convert [file.t24r ...]
+* Without arguments, converts all the .t24r files in the output folder.
+* Text files are written into the output folder of the current folder.
+* The settings of the run come from the result files; the ones that only the text files take,
+* e.g. crd_max_positions_per_family, from the config of the current folder, if there is one.
+* The crd and cop files have the same families and copies as those of the run,
+* though not necessarily in the same order: the families are in the order of the result file.
+*/
+int main(int argc, char* argv[])
+{
+	try {
+		Config config;
+		for (const auto& entry : fs::directory_iterator(fs::current_path())) {
+			if (regex_match(entry.path().filename().string(), config.regex_cfg)) {
+				config.Parse();
+				break;
+			}
+		}
+
+		vector<string> filenames;
+		for (int i = 1; i < argc; ++i) {
+			filenames.push_back(argv[i]);
+		}
+		if (filenames.empty() && fs::is_directory(config.output_folder_name)) {
+			regex regex_t24r(".+\\.t24r", regex::icase);
+			for (const auto& entry : fs::directory_iterator(config.output_folder_name)) {
+				if (regex_match(entry.path().filename().string(), regex_t24r)) {
+					filenames.push_back(entry.path().string());
+				}
+			}
+		}
+		if (filenames.empty()) {
+			std::cout << "Usage: T24_Convert [file.t24r ...]" << endl;
+			return 1;
+		}
+
+		ensure_output_folder(config);
+
+		for (auto const& filename : filenames) {
+			std::cout << endl << "Binary result file " << filename << endl;
+
+			ResultFile result;
+			result.Open(filename);
+
+			auto& header = result.Header();
+			std::cout << "Input file " << result.Filename()
+				<< ", process type " << header.process_type
+				<< ", " << header.family_count << " families, "
+				<< header.interval_count << " intervals, "
+				<< header.island_count << " islands." << endl;
+
+			result.WriteText(config);
+		}
+	}
+	catch (const exception* ex) {
+		// Error().Fatal() throws a pointer.
+		std::cerr << ex->what() << endl;
+		delete ex;
+		return 1;
+	}
+	catch (const exception& ex) {
+		std::cerr << ex.what();
+		return 1;
+	}
+}
@@ -0,0 +1,102 @@
+#include <new>
+#include <algorithm>
+
+#include "Arena.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+static atomic<uint64_t> arena_ids{ 0 };
+
+// Where this thread carves from: a block of one arena, in one generation of it.
+struct ArenaCursor
+{
+	uint64_t arena_id = 0;
+	uint64_t generation = 0;
+	char* next = nullptr;
+	char* end = nullptr;
+};
+static thread_local ArenaCursor cursor;
+
+Arena::Arena(bool huge_pages)
+	: huge_pages(huge_pages), id(++arena_ids)
+{
+}
+
+Arena::~Arena()
+{
+	Release();
+	for (auto const& block : spare) {
+		::operator delete(block.data, align_val_t(block_size));
+	}
+}
+
+void Arena::Release()
+{
+	lock_guard<mutex> lock(guard);
+	++generation;
+	for (auto const& block : used) {
+		if (block.size == block_size) {
+			spare.push_back(block);
+		}
+		else {
+			::operator delete(block.data, align_val_t(block_size));
+		}
+	}
+	used.clear();
+}
+
+size_t Arena::Bytes() const
+{
+	lock_guard<mutex> lock(guard);
+	size_t bytes = 0;
+	for (auto const* blocks : { &used, &spare }) {
+		for (auto const& block : *blocks) {
+			bytes += block.size;
+		}
+	}
+	return bytes;
+}
+
+Arena::Block Arena::NewBlock(size_t at_least)
+{
+	lock_guard<mutex> lock(guard);
+	if (at_least <= block_size && !spare.empty()) {
+		used.push_back(spare.back());
+		spare.pop_back();
+		return used.back();
+	}
+	auto size = (max(at_least, block_size) + block_size - 1) / block_size * block_size;
+	auto data = (char*)::operator new(size, align_val_t(block_size));
+#ifdef MADV_HUGEPAGE
+	if (huge_pages) {
+		madvise(data, size, MADV_HUGEPAGE); // only advice; the blocks are fine without
+	}
+#endif
+	used.push_back({ data, size });
+	return used.back();
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+	// Large ones get a block of their own, so that the current block goes on.
+	if (bytes > block_size / 4) {
+		return NewBlock(bytes).data;
+	}
+
+	auto current = generation.load(memory_order_relaxed);
+	if (cursor.arena_id == id && cursor.generation == current) {
+		auto start = (char*)(((uintptr_t)cursor.next + alignment - 1) & ~(uintptr_t)(alignment - 1));
+		if (start + bytes <= cursor.end) {
+			cursor.next = start + bytes;
+			return start;
+		}
+	}
+
+	auto block = NewBlock(block_size);
+	cursor = { id, current, block.data + bytes, block.data + block.size };
+	return block.data;
+}
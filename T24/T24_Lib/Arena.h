@@ -0,0 +1,61 @@
+#pragma once
+#include <memory_resource>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+/*
+* Memory for the families of one input file at a time (see RepeatFinder's FamilyLevels):
+* the map nodes of the levels are carved in order out of large blocks, and freeing one does nothing.
+* Release() takes all of it back at once, in constant time, and keeps the blocks for the next input file,
+* so that a folder run asks the system for memory only as far as its largest file needs.
+* Every thread carves from a block of its own, so the workers of the extension allocate without a lock;
+* only getting a new block takes one.
+* With huge_pages, the blocks are 2 MB aligned and marked for transparent huge pages (Linux madvise),
+* which spares the TLB in the hot loops over the families.
+*/
+class Arena : public pmr::memory_resource
+{
+public:
+	explicit Arena(bool huge_pages = false);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Everything allocated so far is gone; the blocks stay for the next use.
+	void Release();
+
+	// Bytes of the blocks, in use or kept.
+	size_t Bytes() const;
+
+private:
+	static const size_t block_size = 2 << 20;
+
+	struct Block
+	{
+		char* data;
+		size_t size;
+	};
+
+	bool huge_pages;
+	uint64_t id; // tells the arenas apart in the threads' cursors, even at the same address
+	atomic<uint64_t> generation{ 0 }; // one more on every Release()
+
+	mutable mutex guard;
+	vector<Block> used;
+	vector<Block> spare;
+
+	Block NewBlock(size_t at_least);
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void*, size_t, size_t) override {
+	}
+	bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
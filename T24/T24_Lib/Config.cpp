@@ -0,0 +1,371 @@
+#include <sstream>
+#include <algorithm>
+
+#include "Config.h"
+#include "FilterStatus.h"
+#include "Error.h"
+
+namespace fs = filesystem;
+
+void Config::Parse(fs::path path)
+{
+	folder_current_path = path.string();
+
+	// First file matching regex_cfg
+	for (const auto& entry : fs::directory_iterator(folder_current_path)) {
+		auto filename = entry.path().filename();
+		if (regex_match(filename.string(), regex_cfg)) {
+			file_config_name = filename.string();
+			break;
+		}
+	}
+
+	if (file_config_name == "") {
+		string msg = "No configuration file foudn in folder " + folder_current_path;
+		Error().Fatal(msg);
+	}
+
+	string config_match[] = {
+		label_input_filename_prefix,
+		label_meaningful_letters,
+		label_fpt_min_repeat_length,
+		label_crd_min_repeat_length,
+		label_shift_coordinates,
+		label_mask_repeats,
+		label_masking_character,
+		label_fpt_copy_number,
+		label_crd_copy_number,
+		label_cull_crd,
+		label_crd_max_positions,
+		label_crd_positions_sample,
+		label_crd_all_positions,
+		label_create_fpt_file,
+		label_create_crd_file,
+		label_only_palindromes,
+		label_palindrome_max_nonpalindromic_center,
+		label_palindrome_min_length,
+		label_only_tandems,
+		label_tandems_min_unit,
+		label_tandems_unit_copies,
+		label_palindrome_status,
+		label_tandem_status,
+		label_palindrome_arm_tandem_status,
+		label_palindrome_arm_tandem_min_unit,
+		label_palindrome_arm_tandem_unit_copies,
+		label_split_bunch_maxsize,
+		label_palindrome_variable_centers,
+		label_output_format,
+		label_max_mismatches,
+		label_complement,
+		label_strands,
+		label_prefilter,
+		label_threads,
+		label_huge_pages,
+		label_shards,
+		label_simd,
+		label_progress_interval,
+		label_incremental,
+		label_estimate_samples,
+		label_density_bins,
+		label_shared_repeats,
+		label_packed_cache,
+		label_regions
+	};
+	auto config_match_total = sizeof(config_match) / sizeof(config_match[0]);
+	int config_match_count = 0;
+
+	// Set up config.
+	ifstream config_file;
+	config_file.open(file_config_name);
+	string line;
+	while (std::getline(config_file, line)) {
+		cout << "[got] " << line << endl;
+		if (line.substr(0, 1) == ">") {
+			continue; // skip a comment line
+		}
+		if (is_whitespace(line)) {
+			continue;
+		}
+		auto pos = line.find('=');
+		if (pos == string::npos) {
+			throw new exception((const char* const)("Cannot parse config file: " + line).c_str());
+		}
+		auto first = line.substr(0, pos);
+		auto second = line.substr(pos + 1, line.length() - pos);
+
+		auto last = config_match + config_match_total;
+		auto f = find(config_match, last, first);
+		if (f == last) {
+			continue; // first not defined as a config key
+		}
+		// process first as a config key
+		if (config_map.count(first) > 0) {
+			continue; // already set
+		}
+		config_map[first] = second;
+		regex yes("\\bYES\\b", regex::icase);
+		// Process numerics.
+		if (first == label_fpt_min_repeat_length) {
+			fpt_min_repeat_length = stoi(second); //  can throw
+		}
+		else if (first == label_crd_min_repeat_length) {
+			crd_min_repeat_length = stoi(second); //  can throw
+		}
+		else if (first == label_fpt_copy_number) {
+			fpt_copy_number = stoi(second); // can throw
+		}
+		else if (first == label_crd_copy_number) {
+			crd_copy_number = stoi(second); // can throw
+		}
+		else if (first == label_shift_coordinates) {
+			shift_coordinates = stoi(second); // can throw
+		}
+		else if (first == label_palindrome_max_nonpalindromic_center) {
+			palindrome_center = stoi(second); // can throw
+		}
+		else if (first == label_palindrome_min_length) {
+			palindrome_arm = stoi(second); // can throw
+		}
+		else if (first == label_tandems_min_unit) {
+			tandem_min_unit = stoi(second); // can throw
+		}
+		else if (first == label_tandems_unit_copies) {
+			tandem_unit_copies = stoi(second); // can throw
+		}
+		else if (first == label_palindrome_arm_tandem_min_unit) {
+			palindrome_arm_tandem_min_unit = stoi(second); // can throw
+		}
+		else if (first == label_palindrome_arm_tandem_unit_copies) {
+			palindrome_arm_tandem_unit_copies = stoi(second); // can throw
+		}
+		else if (first == label_split_bunch_maxsize) {
+			split_bunch_maxsize = stoi(second); // can throw
+		}
+		else if (first == label_max_mismatches) {
+			max_mismatches = stoi(second); // can throw
+		}
+		else if (first == label_threads) {
+			threads = stoi(second); // can throw
+		}
+		else if (first == label_shards) {
+			shards = stoi(second); // can throw
+		}
+		else if (first == label_progress_interval) {
+			progress_interval = stoi(second); // can throw
+		}
+		else if (first == label_estimate_samples) {
+			estimate_samples = stoi(second); // can throw
+		}
+		else if (first == label_crd_max_positions) {
+			crd_max_positions = stoi(second); // can throw
+		}
+		else if (first == label_simd) {
+			simd = second;
+			transform(simd.begin(), simd.end(), simd.begin(), ::tolower);
+		}
+		else if (first == label_regions) {
+			regions = second;
+		}
+		// Process bools.
+		else if (first == label_cull_crd) {
+			please_cull_crd = regex_match(second, yes);
+		}
+		else if (first == label_crd_all_positions) {
+			please_create_crd_all_file = regex_match(second, yes);
+		}
+		else if (first == label_incremental) {
+			please_update_incrementally = regex_match(second, yes);
+		}
+		else if (first == label_shared_repeats) {
+			please_find_shared_repeats = regex_match(second, yes);
+		}
+		else if (first == label_create_fpt_file) {
+			please_create_fpt_file = regex_match(second, yes);
+		}
+		else if (first == label_create_crd_file) {
+			please_create_crd_file = regex_match(second, yes);
+		}
+		else if (first == label_mask_repeats) {
+			please_create_masked_file = regex_match(second, yes);
+		}
+		else if (first == label_only_palindromes) {
+			please_only_palindromes = regex_match(second, yes);
+		}
+		else if (first == label_only_tandems) {
+			please_only_tandems = regex_match(second, yes);
+		}
+		else if (first==label_palindrome_variable_centers) {
+			please_only_variable_centers = regex_match(second, yes);
+		}
+		else if (first == label_prefilter) {
+			please_prefilter = regex_match(second, yes);
+		}
+		else if (first == label_huge_pages) {
+			please_use_huge_pages = regex_match(second, yes);
+		}
+		else if (first == label_packed_cache) {
+			please_use_packed_cache = regex_match(second, yes);
+		}
+		// Process filters.
+		else if (first == label_palindrome_status) {
+			palindrome_status = ReadFilterStatus(second);
+		}
+		else if (first == label_tandem_status) {
+			tandem_status = ReadFilterStatus(second);
+		}
+		else if (first == label_palindrome_arm_tandem_status) {
+			palindrome_arm_tandem_status = ReadFilterStatus(second);
+		}
+		// Other special cases.
+		else if (first == label_masking_character) {
+			masking_character = second.at(0);
+		}
+		else if (first == label_output_format) {
+			regex text("\\s*TEXT\\s*", regex::icase);
+			regex binary("\\s*BINARY\\s*", regex::icase);
+			regex both("\\s*BOTH\\s*", regex::icase);
+			if (regex_match(second, binary)) {
+				please_create_text_files = false;
+				please_create_binary_file = true;
+			}
+			else if (regex_match(second, both)) {
+				please_create_text_files = true;
+				please_create_binary_file = true;
+			}
+			else if (!regex_match(second, text)) {
+				Error().Warn("Config: unknown output format " + second + ", text files will be created.");
+			}
+		}
+		else if (first == label_density_bins) {
+			// Bin sizes separated by commas, e.g. 1000,10000,100000
+			stringstream sizes(second);
+			string one_size;
+			while (getline(sizes, one_size, ',')) {
+				try {
+					auto bin_size = stoll(one_size);
+					if (bin_size <= 0) {
+						throw out_of_range(one_size);
+					}
+					density_bins.push_back(bin_size);
+				}
+				catch (const exception&) {
+					Error().Warn("Config: cannot understand density track bin size " + one_size + ", ignored.");
+				}
+			}
+		}
+		else if (first == label_complement) {
+			// Pairs of letters separated by commas, e.g. at,cg
+			regex pair_regex("\\s*(\\w)(\\w)\\s*");
+			stringstream pairs(second);
+			string one_pair;
+			while (getline(pairs, one_pair, ',')) {
+				smatch m;
+				if (!regex_match(one_pair, m, pair_regex)) {
+					Error().Warn("Config: cannot understand complement pair " + one_pair + ", ignored.");
+					continue;
+				}
+				char a = m[1].str()[0], b = m[2].str()[0];
+				for (auto up : { true, false }) {
+					auto x = (char)(up ? toupper(a) : tolower(a));
+					auto y = (char)(up ? toupper(b) : tolower(b));
+					complement[x] = y;
+					complement[y] = x;
+				}
+			}
+		}
+		else if (first == label_crd_positions_sample) {
+			regex random_ones("\\s*RANDOM\\s*", regex::icase);
+			regex first_ones("\\s*FIRST\\s*", regex::icase);
+			if (regex_match(second, random_ones)) {
+				please_sample_crd_positions = true;
+			}
+			else if (!regex_match(second, first_ones)) {
+				Error().Warn("Config: unknown crd positions sample " + second + ", the first positions will be written.");
+			}
+		}
+		else if (first == label_strands) {
+			regex both("\\s*BOTH\\s*", regex::icase);
+			regex forward("\\s*FORWARD\\s*", regex::icase);
+			if (regex_match(second, both)) {
+				please_search_both_strands = true;
+			}
+			else if (!regex_match(second, forward)) {
+				Error().Warn("Config: unknown strands " + second + ", only the forward strand will be searched.");
+			}
+		}
+		// Iterate.
+		++config_match_count;
+	}
+
+	for (auto const& c : config_map[label_meaningful_letters]) {
+		letters.insert(toupper(c));
+	}
+
+	// The deprecated palindromes and tandems, unless the statuses are given:
+	// both of them mean palindromes that are not tandems.
+	if (config_map.count(label_palindrome_status) == 0 && please_only_palindromes) {
+		palindrome_status = FilterStatus::Enforce;
+	}
+	if (config_map.count(label_tandem_status) == 0 && please_only_tandems) {
+		tandem_status = please_only_palindromes ? FilterStatus::Exclude : FilterStatus::Enforce;
+	}
+
+	if (please_search_both_strands && !complement_defined()) {
+		Error().Fatal("Config: strands=both needs the complement, e.g. complement=at,cg");
+	}
+	if (shards > 1 && (please_search_both_strands || approximate_requested())) {
+		Error().Fatal("Config: sharded runs only find exact repeats on the forward strand.");
+	}
+	if (please_update_incrementally
+		&& (shards > 1 || please_search_both_strands || approximate_requested() || please_only_variable_centers)) {
+		Error().Fatal("Config: incremental runs only find exact repeats on the forward strand, in one process.");
+	}
+	if (estimate_requested() && (shards > 1 || please_update_incrementally)) {
+		Error().Fatal("Config: density estimates run in one process, without incremental updates.");
+	}
+	if (please_find_shared_repeats && (shards > 1 || please_update_incrementally || estimate_requested())) {
+		Error().Fatal("Config: cross_files runs find the repeats of all the input files at once, in one process.");
+	}
+	if (!regions.empty() && (shards > 1 || please_update_incrementally || estimate_requested()
+		|| please_find_shared_repeats || approximate_requested() || please_only_variable_centers)) {
+		Error().Fatal("Config: regions runs find exact repeats file by file, in one process.");
+	}
+	if (crd_max_positions < 0) {
+		Error().Warn("Config: negative crd_max_positions_per_family, all the positions will be written.");
+		crd_max_positions = 0;
+	}
+	if (estimate_requested()
+		&& (approximate_requested() || please_only_variable_centers || filters_requested())) {
+		Error().Warn("Config: the density estimate is of all the exact repeats, without filters.");
+	}
+	if (please_search_both_strands && approximate_requested()) {
+		Error().Warn("Config: approximate repeats are only searched on the forward strand.");
+		please_search_both_strands = false;
+	}
+
+} // Parse()
+
+FilterStatus Config::ReadFilterStatus(string s)
+{
+	// Enforce
+	regex enforce("^ENFORCE", regex::icase);
+	regex include("^INCLUDE", regex::icase);
+	regex yes("^YES", regex::icase);
+	// Ignore
+	regex ignore("^IGNORE", regex::icase);
+	// Exclude
+	regex exclude("^EXCLUDE", regex::icase);
+	regex no("^NO", regex::icase);
+
+	if (regex_match(s, ignore)) {
+		return FilterStatus::Ignore;
+	}
+	if (regex_match(s, exclude) || regex_match(s, no)) {
+		return FilterStatus::Exclude;
+	}
+	if (regex_match(s, enforce) || regex_match(s, yes) || regex_match(s, include)) {
+		return FilterStatus::Enforce;
+	}
+
+	return FilterStatus::Ignore;
+} // ReadFilterStatus()
\ No newline at end of file
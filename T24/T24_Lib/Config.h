@@ -0,0 +1,211 @@
+#pragma once
+#include <string>
+#include <regex>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <ios>
+
+#include "FilterStatus.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+enum class Process_Type {
+	fpt, crd
+};
+
+struct Config
+{
+	unordered_map<string, string> config_map; // Map of values
+	streamsize fpt_min_repeat_length, crd_min_repeat_length;
+	unsigned int fpt_copy_number, crd_copy_number;
+	signed int shift_coordinates = 0;
+
+	bool please_create_fpt_file = true; // Need to generate the footprint output file?
+	bool please_create_crd_file = true; // Need to generate the coordinates output file?
+	
+	bool please_create_masked_file = false; // Need to create the _srm output file?
+
+	bool please_create_text_files = true; // fpt, e_, srm, crd, cop files
+	bool please_create_binary_file = false; // .t24r file, see ResultFile.h
+
+	bool please_cull_crd = true;
+
+	int crd_max_positions = 0; // per family in the crd file; 0 means all of them, see TextOutput::WriteCoordinates()
+	bool please_sample_crd_positions = false; // a reproducible random sample of them rather than the first ones
+	bool please_create_crd_all_file = false; // all the positions of the capped families, in crd_all_{filename}.gb
+
+	bool please_only_palindromes = false;
+	int palindrome_arm;
+	int palindrome_center;
+	bool please_only_variable_centers = false;
+
+	bool please_only_tandems = false;
+	int tandem_min_unit;
+	int tandem_unit_copies;
+
+	// The filters on the families, see FamilyFilter.h.
+	FilterStatus palindrome_status = FilterStatus::Ignore;
+	FilterStatus tandem_status = FilterStatus::Ignore;
+	FilterStatus palindrome_arm_tandem_status = FilterStatus::Ignore;
+
+	int palindrome_arm_tandem_min_unit = 0;
+	int palindrome_arm_tandem_unit_copies = 0;
+
+	int split_bunch_maxsize = -1;
+
+	int max_mismatches = 0; // per repeat copy; more than zero means approximate repeats
+
+	unordered_map<char, char> complement; // letter -> complementary letter, both ways, both cases
+	bool please_search_both_strands = false; // also find reverse complement copies
+
+	bool please_prefilter = false; // count the first phase sequences approximately first, see CountingFilter.h
+
+	int threads = 0; // for the extension; 0 means one per hardware thread
+
+	bool please_use_huge_pages = false; // for the families, see Arena.h
+
+	int shards = 1; // processes sharing the work on every input file, see ShardFile.h
+	int shard = -1; // this process's shard, 0 to shards - 1; negative means all of them
+
+	bool please_update_incrementally = false; // keep a state for appended input, see IncrementalState.h
+
+	int progress_interval = 30; // seconds between progress reports; 0 means none
+
+	vector<streamsize> density_bins; // bin sizes of the footprint density tracks, see DensityTracks.h
+
+	int estimate_samples = 0; // letters drawn to estimate the density instead of finding the repeats, see DensityEstimate.h
+
+	bool please_find_shared_repeats = false; // one run over all the input files together, see SharedRepeats.h
+
+	bool please_use_packed_cache = false; // reload the input files from .t24p files, see PackedFasta.h
+
+	string regions; // BED file of the target regions, see TargetRegions.h; empty means the whole sequences
+
+	string simd = "auto"; // instruction set for comparing letters: auto, avx512, avx2, sse2 or scalar, see Lce.h
+
+	unordered_set<char> letters; // legitimate letters to be analyzed; case insensitive
+	char masking_character = 'N';
+
+	string folder_current_path;
+	string file_config_name = "";
+	regex regex_cfg;
+
+	// Labels
+	string label_fpt_min_repeat_length = "fpt_min_repeat_length",
+		label_crd_min_repeat_length = "crd_min_repeat_length";
+	string label_fpt_copy_number = "fpt_copy_number",
+		label_crd_copy_number = "crd_copy_number";
+	string label_shift_coordinates = "shift";
+	string label_mask_repeats = "mask";
+	string label_masking_character = "masking_character";
+	string label_meaningful_letters = "meaningful_letters";
+	string label_cull_crd = "cull_crd";
+	string label_crd_max_positions = "crd_max_positions_per_family";
+	string label_crd_positions_sample = "crd_positions_sample";
+	string label_crd_all_positions = "crd_all_positions";
+	string label_create_fpt_file = "create_fpt_file",
+		label_create_crd_file = "create_crd_file";
+	string label_only_palindromes = "palindromes"; // deprecated
+	string label_palindrome_max_nonpalindromic_center = "palindrome_center";
+	string label_palindrome_min_length = "palindrome_arm";
+	string label_only_tandems = "tandems"; // deprecated
+	string label_tandems_min_unit = "min_unit";
+	string label_tandems_unit_copies = "unit_copies";
+	string label_palindrome_status = "palindrome_status";
+	string label_tandem_status = "tandem_status";
+	string label_palindrome_arm_tandem_status = "palindrome_arms_tandems_status";
+	string label_palindrome_arm_tandem_min_unit = "palindrome_arm_tandem_min_unit";
+	string label_palindrome_arm_tandem_unit_copies = "palindrome_arm_tandem_unit_copies";
+	string label_input_filename_prefix = "filename_prefix_to_replace";
+	string label_split_bunch_maxsize = "split_bunch_maxsize";
+	string label_palindrome_variable_centers = "variable_centers";
+	string label_output_format = "output_format";
+	string label_max_mismatches = "max_mismatches";
+	string label_complement = "complement";
+	string label_strands = "strands";
+	string label_prefilter = "prefilter";
+	string label_threads = "threads";
+	string label_huge_pages = "huge_pages";
+	string label_shards = "shards";
+	string label_simd = "simd";
+	string label_progress_interval = "progress";
+	string label_incremental = "incremental";
+	string label_estimate_samples = "estimate";
+	string label_density_bins = "density_tracks";
+	string label_shared_repeats = "cross_files";
+	string label_packed_cache = "packed_cache";
+	string label_regions = "regions";
+
+	string output_folder_name = "Output";
+
+	streamsize absolute_origin = 0; // from the beginning of the chromosome
+
+	Config(string config_regex = "T24.*\\.cfg") {
+		regex_cfg = regex(config_regex, regex::icase);
+	}
+
+	void Parse(fs::path = fs::current_path());
+
+	FilterStatus ReadFilterStatus(string s);
+
+	bool is_whitespace(string s)
+	{
+		return s.find_first_not_of(" \t") == string::npos;
+	}
+
+	bool split_requested()
+	{
+		return split_bunch_maxsize > 0;
+	}
+
+	bool approximate_requested()
+	{
+		return max_mismatches > 0;
+	}
+
+	bool estimate_requested()
+	{
+		return estimate_samples > 0;
+	}
+
+	bool filters_requested()
+	{
+		return palindrome_status != FilterStatus::Ignore || tandem_status != FilterStatus::Ignore
+			|| palindrome_arm_tandem_status != FilterStatus::Ignore;
+	}
+
+	// A process working on one shard.
+	bool sharded()
+	{
+		return shards > 1 && shard >= 0;
+	}
+
+	bool complement_defined()
+	{
+		return !complement.empty();
+	}
+
+	// A letter without a complement is its own complement.
+	char complement_of(char c) {
+		auto found = complement.find(c);
+		return found == complement.end() ? c : found->second;
+	}
+
+	// The 0-based chromosome coordinate of the first letter, as in BED files:
+	// absolute_origin is the 1-based start of range=chr:start-end, 0 without one.
+	streamsize zero_based_origin() const {
+		return absolute_origin > 0 ? absolute_origin - 1 : 0;
+	}
+
+	// Case insensitive.
+	// Not a valid letter?
+	bool is_N_letter(char c) const {
+		return letters.count(toupper(c)) == 0;
+	}
+};
+
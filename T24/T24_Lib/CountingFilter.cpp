@@ -0,0 +1,59 @@
+#include <functional>
+#include <algorithm>
+
+#include "CountingFilter.h"
+
+using namespace std;
+
+CountingFilter::CountingFilter(size_t items, int cells_per_item, int hashes)
+	: hashes(hashes)
+{
+	// A power of two, so that a cell is found with a mask.
+	size_t size = 1024;
+	while (size < items * cells_per_item) {
+		size *= 2;
+	}
+	counters.assign(size, 0);
+	mask = size - 1;
+}
+
+uint64_t CountingFilter::Hash(string_view item)
+{
+	// Mix the standard hash, it is not necessarily good in all the bits (splitmix64 finalizer).
+	uint64_t h = hash<string_view>()(item);
+	h ^= h >> 30;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 27;
+	h *= 0x94D049BB133111EBULL;
+	h ^= h >> 31;
+	return h;
+}
+
+void CountingFilter::Add(string_view item)
+{
+	auto h = Hash(item);
+	auto current = EstimateHash(h);
+	if (current == UINT8_MAX) {
+		return; // saturated
+	}
+	for (int i = 0; i < hashes; ++i) {
+		auto& counter = counters[Cell(h, i)];
+		if (counter == current) {
+			++counter;
+		}
+	}
+}
+
+unsigned CountingFilter::Estimate(string_view item) const
+{
+	return EstimateHash(Hash(item));
+}
+
+unsigned CountingFilter::EstimateHash(uint64_t h) const
+{
+	unsigned estimate = UINT8_MAX;
+	for (int i = 0; i < hashes; ++i) {
+		estimate = min(estimate, (unsigned)counters[Cell(h, i)]);
+	}
+	return estimate;
+}
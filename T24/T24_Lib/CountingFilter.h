@@ -0,0 +1,38 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/*
+* Counting Bloom filter with saturating 8-bit counters and conservative update:
+* an item only raises those of its counters that are at the minimum.
+* Estimate() never undercounts, so whatever it lets through still has to be counted exactly;
+* what it stops surely has fewer copies.
+*/
+class CountingFilter
+{
+public:
+	// Sized for the given number of items: cells_per_item counters for each of them.
+	CountingFilter(size_t items, int cells_per_item = 4, int hashes = 3);
+
+	void Add(string_view item);
+	unsigned Estimate(string_view item) const;
+
+	size_t Bytes() const {
+		return counters.size();
+	}
+
+private:
+	vector<uint8_t> counters;
+	size_t mask;
+	int hashes;
+
+	static uint64_t Hash(string_view item);
+	unsigned EstimateHash(uint64_t hash) const;
+	size_t Cell(uint64_t hash, int i) const {
+		// Double hashing: h1 + i * h2, h2 odd.
+		return (size_t)(((hash & 0xFFFFFFFF) + i * ((hash >> 32) | 1)) & mask);
+	}
+};
@@ -0,0 +1,43 @@
+#include <vector>
+
+#include "Crc32.h"
+
+using namespace std;
+
+uint32_t crc32(const void* data, size_t size, uint32_t crc)
+{
+	// Made once, also when the first calls come from several threads, e.g. an InputReader's.
+	// Table t is for a byte followed by t more, so that 8 bytes take 8 lookups and no dependency.
+	static const auto table = [] {
+		vector<uint32_t> table(8 * 256);
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+		for (uint32_t t = 1; t < 8; ++t) {
+			for (uint32_t i = 0; i < 256; ++i) {
+				auto previous = table[(t - 1) * 256 + i];
+				table[t * 256 + i] = table[previous & 0xFF] ^ (previous >> 8);
+			}
+		}
+		return table;
+	}();
+	auto t = table.data();
+
+	auto bytes = (const unsigned char*)data;
+	crc = ~crc;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		auto low = crc ^ (bytes[i] | (uint32_t)bytes[i + 1] << 8 | (uint32_t)bytes[i + 2] << 16 | (uint32_t)bytes[i + 3] << 24);
+		auto high = bytes[i + 4] | (uint32_t)bytes[i + 5] << 8 | (uint32_t)bytes[i + 6] << 16 | (uint32_t)bytes[i + 7] << 24;
+		crc = t[7 * 256 + (low & 0xFF)] ^ t[6 * 256 + ((low >> 8) & 0xFF)] ^ t[5 * 256 + ((low >> 16) & 0xFF)] ^ t[4 * 256 + (low >> 24)]
+			^ t[3 * 256 + (high & 0xFF)] ^ t[2 * 256 + ((high >> 8) & 0xFF)] ^ t[1 * 256 + ((high >> 16) & 0xFF)] ^ t[high >> 24];
+	}
+	for (; i < size; ++i) {
+		crc = t[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// CRC-32 (IEEE), continuing from crc.
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
@@ -0,0 +1,273 @@
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <cmath>
+
+#include "DensityEstimate.h"
+#include "SequenceTable.h"
+#include "TextOutput.h"
+#include "Error.h"
+
+using namespace std;
+
+static const streamsize estimate_block_length = 64;
+
+// 95% Wilson score interval of covered out of samples, as fractions.
+static void wilson_interval(size_t covered, size_t samples, double& low, double& high)
+{
+	const double z = 1.96;
+	double n = (double)samples;
+	double p = covered / n;
+	double denominator = 1 + z * z / n;
+	double center = (p + z * z / (2 * n)) / denominator;
+	double half = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / denominator;
+	low = max(0.0, center - half);
+	high = min(1.0, center + half);
+}
+
+double DensityEstimate::subdensity_percent() const
+{
+	return meaningful_letters == 0 ? 0 : density_percent * sequence_size / meaningful_letters;
+}
+
+double DensityEstimate::subdensity_low() const
+{
+	return meaningful_letters == 0 ? 0 : density_low * sequence_size / meaningful_letters;
+}
+
+double DensityEstimate::subdensity_high() const
+{
+	return meaningful_letters == 0 ? 0 : density_high * sequence_size / meaningful_letters;
+}
+
+DensityEstimate estimate_density(string_view sequence, Config config, Process_Type pt)
+{
+	auto min_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	auto copy_number = pt == Process_Type::fpt ? config.fpt_copy_number : config.crd_copy_number;
+	auto size = (streamsize)sequence.size();
+
+	bool is_N[256];
+	char complement[256];
+	for (int c = 0; c < 256; ++c) {
+		is_N[c] = config.is_N_letter((char)c);
+		complement[c] = config.complement_of((char)c);
+	}
+
+	DensityEstimate estimate;
+	estimate.sequence_size = sequence.size();
+
+	// The letters to check, in blocks: all of them if there are few enough.
+	bool every_letter = size <= config.estimate_samples;
+	vector<streamsize> blocks;
+	if (every_letter) {
+		for (streamsize start = 0; start < size; start += estimate_block_length) {
+			blocks.push_back(start);
+		}
+	}
+	else {
+		mt19937_64 generator(24); // the same samples on every run
+		uniform_int_distribution<streamsize> draw(0, max((streamsize)0, size - estimate_block_length));
+		for (auto i = max(1, config.estimate_samples / (int)estimate_block_length); i > 0; --i) {
+			blocks.push_back(draw(generator));
+		}
+		sort(blocks.begin(), blocks.end());
+	}
+
+	// What puts a letter x in the footprints, see RepeatFinder::CalculateFootprints():
+	//	- a sequence of the minimum length with enough copies, starting from x - min_length + 2 to x + 1;
+	//	  the first phase registers it at the position right before it, and its footprint starts there;
+	//	- one letter longer, from x - min_length to x, for the families that the extension finds.
+	// Every different sequence around the blocks gets a counter;
+	// both strands, a sequence and its reverse complement share one.
+	const uint32_t no_counter = UINT32_MAX;
+	SequenceTable<uint32_t> counter_of[2] = { // per length: min_length, min_length + 1
+		SequenceTable<uint32_t>(sequence), SequenceTable<uint32_t>(sequence) };
+	vector<uint32_t> counters;
+	auto counter = [&](int longer, streamsize start) {
+		// Only meaningful letters, but the first of the longer ones.
+		for (auto i = start + longer; i < start + longer + min_length; ++i) {
+			if (is_N[(unsigned char)sequence[i]]) {
+				return no_counter;
+			}
+		}
+		auto seq = sequence.substr(start, min_length + longer);
+		auto& found = counter_of[longer][seq];
+		if (found == 0) {
+			counters.push_back(0);
+			found = (uint32_t)counters.size(); // index + 1, as 0 is a new one
+			if (config.please_search_both_strands) {
+				string reverse(seq.rbegin(), seq.rend());
+				for (auto& c : reverse) {
+					c = complement[(unsigned char)c];
+				}
+				auto added = found;
+				counter_of[longer][reverse] = added;
+				return added - 1;
+			}
+		}
+		return found - 1;
+	};
+
+	// Per block, the counters of the sequences that start from first[0] and first[1] on.
+	struct Block
+	{
+		streamsize start, end;
+		streamsize first[2];
+		size_t counters_first[2], counters_end[2];
+	};
+	vector<Block> block_list;
+	vector<uint32_t> block_counters;
+	for (auto start : blocks) {
+		Block block;
+		block.start = start;
+		block.end = min(start + estimate_block_length, size);
+		block.first[0] = max((streamsize)1, start - min_length + 1); // one more, the end of the first longer one
+		block.first[1] = max((streamsize)0, start - min_length);
+		// The extension stops one letter before the end.
+		streamsize last[2] = { min(block.end, size - min_length), min(block.end - 1, size - min_length - 2) };
+		for (int longer = 0; longer < 2; ++longer) {
+			block.counters_first[longer] = block_counters.size();
+			for (auto seq_start = block.first[longer]; seq_start <= last[longer]; ++seq_start) {
+				block_counters.push_back(counter(longer, seq_start));
+			}
+			block.counters_end[longer] = block_counters.size();
+		}
+		block_list.push_back(block);
+	}
+
+	// A bit per hash, so that most sequences of the pass are turned down without a lookup.
+	int bits_log2 = 10;
+	while (((size_t)1 << bits_log2) < (counter_of[0].Size() + counter_of[1].Size()) * 64) {
+		++bits_log2;
+	}
+	vector<uint64_t> bits(((size_t)1 << bits_log2) / 64 + 1, 0);
+	auto bit_of = [bits_log2](uint64_t hash) {
+		return (size_t)((hash * 0x9E3779B97F4A7C15ULL) >> (64 - bits_log2));
+	};
+	for (auto& level : counter_of) {
+		for (auto const& [seq, c] : level) {
+			auto bit = bit_of(SequenceTable<uint32_t>::Hash(seq));
+			bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+		}
+	}
+	// Whether it is one of them; if so, one more copy.
+	auto count_copy = [&](int longer, streamsize start, uint64_t hash) {
+		auto bit = bit_of(hash);
+		if ((bits[bit / 64] & ((uint64_t)1 << (bit % 64))) == 0) {
+			return false;
+		}
+		auto found = counter_of[longer].Find(sequence.substr(start, min_length + longer), hash);
+		if (found == nullptr) {
+			return false;
+		}
+		if (counters[*found - 1] < copy_number) {
+			++counters[*found - 1];
+		}
+		return true;
+	};
+
+	// The pass: count the copies of those sequences, as RepeatFinder::FindSeeds() would.
+	// The longer ones end with one of the minimum length around the blocks, so on the forward strand
+	// they are only looked for after that; their hash is the one of the minimum length plus the letter before.
+	RollingHash rolling((size_t)min_length);
+	uint64_t letter_before_power = 1;
+	for (streamsize i = 0; i < min_length; ++i) {
+		letter_before_power *= RollingHash::base;
+	}
+	streamsize last_N = -1;
+	size_t meaningful_letters = 0;
+	for (streamsize i = 0; i < min(min_length, size); ++i) {
+		rolling.Add(sequence[i]);
+		if (is_N[(unsigned char)sequence[i]]) {
+			last_N = i;
+		}
+	}
+	for (auto check_position = min_length; check_position < size; ++check_position) {
+		auto check_letter = sequence[check_position];
+		rolling.Roll(check_letter, sequence[check_position - min_length]);
+		if (is_N[(unsigned char)check_letter]) {
+			last_N = check_position;
+			continue;
+		}
+		++meaningful_letters;
+		if (check_position - last_N < min_length) {
+			continue;
+		}
+		auto hash = rolling.Hash();
+		auto counted = count_copy(0, check_position + 1 - min_length, hash);
+		if ((counted || config.please_search_both_strands) && check_position + 1 < size) {
+			auto letter_before = (unsigned char)sequence[check_position - min_length];
+			count_copy(1, check_position - min_length, hash + letter_before * letter_before_power);
+		}
+	}
+	estimate.meaningful_letters = meaningful_letters;
+
+	// The letters in the footprints, per block.
+	vector<size_t> block_covered;
+	vector<char> covered;
+	for (auto const& block : block_list) {
+		covered.assign((size_t)(block.end - block.start), 0);
+		for (int longer = 0; longer < 2; ++longer) {
+			// The footprint of one that starts at seq_start, as the first phase registers it or as extended.
+			auto footprint_start = longer == 0 ? -1 : 0;
+			for (auto i = block.counters_first[longer]; i < block.counters_end[longer]; ++i) {
+				auto c = block_counters[i];
+				if (c == no_counter || counters[c] < copy_number) {
+					continue;
+				}
+				auto seq_start = block.first[longer] + (streamsize)(i - block.counters_first[longer]);
+				auto from = max(block.start, seq_start + footprint_start);
+				auto to = min(block.end, seq_start + footprint_start + min_length + longer);
+				for (auto x = from; x < to; ++x) {
+					covered[(size_t)(x - block.start)] = 1;
+				}
+			}
+		}
+		block_covered.push_back((size_t)count(covered.begin(), covered.end(), (char)1));
+		estimate.samples += (size_t)(block.end - block.start);
+		estimate.covered += block_covered.back();
+	}
+
+	if (estimate.samples > 0) {
+		double p = (double)estimate.covered / estimate.samples;
+		double low = p, high = p;
+		if (!every_letter) {
+			// Repeats come in runs, so the letters of a block are not independent:
+			// the wider of the binomial interval of the letters and the normal one from the spread of the blocks.
+			wilson_interval(estimate.covered, estimate.samples, low, high);
+			auto m = block_list.size();
+			if (m > 1) {
+				double spread = 0;
+				for (size_t i = 0; i < m; ++i) {
+					auto deviation = block_covered[i] - p * (block_list[i].end - block_list[i].start);
+					spread += deviation * deviation;
+				}
+				double half = 1.96 * sqrt(spread * m / (m - 1)) / estimate.samples;
+				low = min(low, max(0.0, p - half));
+				high = max(high, min(1.0, p + half));
+			}
+		}
+		estimate.density_percent = 100.0 * p;
+		estimate.density_low = 100.0 * low;
+		estimate.density_high = 100.0 * high;
+	}
+	return estimate;
+} // estimate_density()
+
+void write_estimate_summary(Config config, string filename, const DensityEstimate& estimate)
+{
+	auto output_summary_filename = summary_file_name(config);
+	ofstream of_sum(output_summary_filename, ios::app);
+	if (!of_sum) {
+		Error().Fatal("Cannot open for writing file: " + output_summary_filename);
+	}
+
+	of_sum.setf(ios::fixed, ios::floatfield);
+	of_sum << summary_row_name(filename) << "\t" << setprecision(4) << estimate.density_percent << "%"
+		<< "\t" << estimate.subdensity_percent() << "%"
+		<< "\t" << estimate.density_low << "-" << estimate.density_high << "%"
+		<< "\t" << estimate.subdensity_low() << "-" << estimate.subdensity_high() << "%"
+		<< endl;
+}
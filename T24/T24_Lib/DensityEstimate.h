@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "Config.h"
+
+using namespace std;
+
+/*
+* Footprint density without finding the repeats, for triage of many inputs (config.estimate_samples).
+* A letter is in the footprints when a sequence of the minimum length around it has enough copies
+* (as registered by the first phase, see RepeatFinder::FindSeeds()), or one a letter longer
+* (as the extension would find it). The estimate checks that for about config.estimate_samples letters,
+* in blocks of 64 drawn at random:
+*	- the sequences around the blocks are put in a SequenceTable first,
+*	- one pass over the input rolls a hash along it and counts the copies of just those sequences,
+*	- the share of the letters checked that are in the footprints estimates the density.
+* The 95% interval allows for repeats coming in runs, from the spread of the blocks.
+* The input is loaded whole, as for a full run (see FastaFile.h); the memory the estimate takes
+* beyond it is in proportion to the number of samples, not to the input.
+* With fewer letters than samples, every letter is checked and the figures are the exact ones.
+* Filters and approximate repeats are not taken into account.
+*/
+struct DensityEstimate
+{
+	size_t sequence_size = 0;
+	size_t meaningful_letters = 0; // counted as by RepeatFinder::FindSeeds()
+	size_t samples = 0; // letters checked
+	size_t covered = 0; // samples in the footprints
+
+	// Percentages of sequence_size, as in summary.tab.
+	double density_percent = 0, density_low = 0, density_high = 0;
+
+	// The same of meaningful_letters.
+	double subdensity_percent() const;
+	double subdensity_low() const;
+	double subdensity_high() const;
+};
+
+DensityEstimate estimate_density(string_view sequence, Config config, Process_Type pt);
+
+// summary.tab line: filename, density, subdensity, then the intervals of both.
+void write_estimate_summary(Config config, string filename, const DensityEstimate& estimate);
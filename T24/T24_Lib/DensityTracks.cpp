@@ -0,0 +1,123 @@
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+
+#include "DensityTracks.h"
+#include "TextOutput.h"
+#include "TaskPool.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+string bin_size_label(streamsize bin_size)
+{
+	if (bin_size % 1000000 == 0) {
+		return to_string(bin_size / 1000000) + "Mb";
+	}
+	if (bin_size % 1000 == 0) {
+		return to_string(bin_size / 1000) + "kb";
+	}
+	return to_string(bin_size);
+}
+
+DensityTracks::DensityTracks(Config config, const FastaFile& input)
+	: config(config), basename(output_basename(config, input.filename)),
+	chromosome(input.sequence_name), sequence_size((streamsize)input.sequence.size())
+{
+	if (chromosome.empty()) {
+		chromosome = basename;
+	}
+}
+
+void DensityTracks::AddIsland(const Island& island)
+{
+	covered_before.push_back(island_start.empty() ? 0
+		: covered_before.back() + island_end.back() - island_start.back());
+	island_start.push_back(island.start);
+	island_end.push_back(island.end + 1);
+}
+
+streamsize DensityTracks::CoveredBefore(streamsize position) const
+{
+	// The last island that starts before position.
+	auto after = upper_bound(island_start.begin(), island_start.end(), position - 1);
+	if (after == island_start.begin()) {
+		return 0;
+	}
+	auto i = (size_t)(after - island_start.begin()) - 1;
+	return covered_before[i] + min(position, island_end[i]) - island_start[i];
+}
+
+void DensityTracks::Finish()
+{
+	for (auto bin_size : config.density_bins) {
+		WriteTrack(bin_size);
+	}
+}
+
+void DensityTracks::WriteTrack(streamsize bin_size)
+{
+	auto label = bin_size_label(bin_size);
+	auto output_filename = (fs::path(config.output_folder_name) /= "dens_" + basename + "_" + label + ".bedGraph").string();
+	ofstream of(output_filename, ios::binary);
+	if (!of) {
+		Error().Fatal("Cannot open for writing file: " + output_filename);
+	}
+	of << "track type=bedGraph name=\"" << basename << " " << label << "\""
+		<< " description=\"Footprint density, " << label << " bins\" viewLimits=0:1 autoScale=off" << "\n";
+
+	// The bins in chunks, the runs of every chunk on their own, then all of them in order,
+	// a run that goes on in the next chunk joined with it.
+	// The densities are rounded as they are written, so that the runs are those of the file.
+	const streamsize chunk_bins = 1 << 16;
+	auto bins = (sequence_size + bin_size - 1) / bin_size;
+	auto chunks = (bins + chunk_bins - 1) / chunk_bins;
+	vector<vector<Run>> runs((size_t)chunks);
+
+	TaskPool pool(config.threads);
+	for (streamsize chunk = 0; chunk < chunks; ++chunk) {
+		pool.Submit([&, chunk](int) {
+			auto& chunk_runs = runs[(size_t)chunk];
+			auto bin_end = min(bins, (chunk + 1) * chunk_bins);
+			auto covered_at = CoveredBefore(chunk * chunk_bins * bin_size);
+			for (auto bin = chunk * chunk_bins; bin < bin_end; ++bin) {
+				auto start = bin * bin_size;
+				auto end = min(start + bin_size, sequence_size);
+				auto covered_at_end = CoveredBefore(end);
+				auto density = round(10000.0 * (covered_at_end - covered_at) / (end - start)) / 10000;
+				covered_at = covered_at_end;
+				if (!chunk_runs.empty() && chunk_runs.back().density == density) {
+					chunk_runs.back().end = end;
+				}
+				else {
+					chunk_runs.push_back({ start, end, density });
+				}
+			}
+		});
+	}
+	pool.Run();
+
+	auto origin = config.zero_based_origin() + config.shift_coordinates;
+	of.setf(ios::fixed, ios::floatfield);
+	of << setprecision(4);
+	Run run = { 0, 0, -1 };
+	for (auto const& chunk_runs : runs) {
+		for (auto const& next : chunk_runs) {
+			if (next.density == run.density) {
+				run.end = next.end;
+				continue;
+			}
+			if (run.density >= 0) {
+				of << chromosome << "\t" << origin + run.start << "\t" << origin + run.end << "\t" << run.density << "\n";
+			}
+			run = next;
+		}
+	}
+	if (run.density >= 0) {
+		of << chromosome << "\t" << origin + run.start << "\t" << origin + run.end << "\t" << run.density << "\n";
+	}
+	std::cout << "Density track: " << output_filename << endl;
+} // WriteTrack()
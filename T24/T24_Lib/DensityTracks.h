@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ios>
+
+#include "Config.h"
+#include "FastaFile.h"
+#include "RepeatFinder.h"
+
+using namespace std;
+
+/*
+* Footprint density tracks for genome browsers, one bedGraph file per bin size in config.density_bins:
+*	Output/dens_{basename}_{bin size}.bedGraph
+* Every line is a run of bins with the same density as written, the share of their letters
+* in the footprints to 4 decimals, 0-based and end exclusive in the coordinates of the chromosome:
+* the origin of range=chr:start-end (see Config::zero_based_origin()) and the shift added.
+* The coarse tracks let a browser show whole chromosomes without the per-letter data.
+*
+* The islands come in order; a prefix sum of their lengths gives the footprints before any position,
+* so every bin is two lookups and the bins are computed in parallel, in chunks (see TaskPool.h).
+*/
+class DensityTracks
+{
+public:
+	DensityTracks(Config config, const FastaFile& input);
+
+	void AddIsland(const Island& island);
+	void Finish();
+
+private:
+	Config config;
+	string basename;
+	string chromosome;
+	streamsize sequence_size;
+
+	vector<streamsize> island_start, island_end; // end exclusive
+	vector<streamsize> covered_before; // per island, the letters of the islands before it
+
+	// Letters in the footprints before position.
+	streamsize CoveredBefore(streamsize position) const;
+
+	// Bins [start, end) with the same density.
+	struct Run
+	{
+		streamsize start;
+		streamsize end;
+		double density;
+	};
+
+	void WriteTrack(streamsize bin_size);
+};
+
+// "1kb", "10kb", "1Mb", or the number of letters.
+string bin_size_label(streamsize bin_size);
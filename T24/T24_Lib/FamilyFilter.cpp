@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cctype>
+
+#include "FamilyFilter.h"
+#include "Lce.h"
+#include "Error.h"
+
+using namespace std;
+
+size_t palindrome_arm_length(string_view seq, const char* complement_table)
+{
+	auto half = seq.length() / 2;
+	if (half == 0) {
+		return 0;
+	}
+	// The arm is taken as the index of the first letter that does not match,
+	// or of the last one compared.
+	auto matching = complement_table != nullptr
+		? lce_mirror(&seq[0], &seq[seq.length() - 1], half, complement_table)
+		: lce_mirror(&seq[0], &seq[seq.length() - 1], half);
+	return min(matching, half - 1);
+}
+
+bool is_palindrome(string_view seq, streamsize arm_min_length, streamsize stalk_max_length, const char* complement_table)
+{
+	if (arm_min_length <= 0 || seq.empty()) {
+		return true;
+	}
+	auto arm_length = (streamsize)palindrome_arm_length(seq, complement_table);
+	if (arm_length < arm_min_length) {
+		return false;
+	}
+	auto stalk_length = (streamsize)seq.length() - 2 * arm_length;
+	return stalk_length <= stalk_max_length;
+}
+
+bool is_tandem(string_view seq, int min_unit, int unit_copies)
+{
+	// As the regex ^(\w{min_unit,})\1{unit_copies - 1,}$ would match it.
+	auto n = (streamsize)seq.length();
+	for (auto c : seq) {
+		if (!isalnum((unsigned char)c) && c != '_') {
+			return false;
+		}
+	}
+	for (streamsize unit = max(min_unit, 1); unit * max(unit_copies, 1) <= n; ++unit) {
+		if (n % unit != 0) {
+			continue;
+		}
+		streamsize i = unit;
+		while (i < n && tolower((unsigned char)seq[i]) == tolower((unsigned char)seq[i - unit])) {
+			++i;
+		}
+		if (i == n) {
+			return true;
+		}
+	}
+	return false;
+}
+
+FamilyFilter::FamilyFilter(Config config, const char* complement_table)
+{
+	if (!config.complement_defined()) {
+		complement_table = nullptr;
+	}
+
+	streamsize arm_min_length = config.palindrome_arm;
+	streamsize stalk_max_length = config.palindrome_center;
+	bool palindromes_needed = config.palindrome_status != FilterStatus::Ignore
+		|| config.palindrome_arm_tandem_status != FilterStatus::Ignore;
+	if (palindromes_needed && stalk_max_length < 0) {
+		Error().Warn("Config: palindrome stalk length is " + to_string(stalk_max_length) + ", understood as ZERO (no stalk allowed).");
+		stalk_max_length = 0;
+	}
+	if (palindromes_needed && arm_min_length <= 0) {
+		Error().Warn("Config: palindrome minimum arm length is " + to_string(arm_min_length)
+			+ ", interpreted as zero and is therefore ignored. Effectively, the palindrome constraint is NOT APPLIED.");
+	}
+
+	if (config.palindrome_status != FilterStatus::Ignore && arm_min_length > 0) {
+		stages.push_back({ "palindromes", config.palindrome_status,
+			[=](string_view seq) {
+				return is_palindrome(seq, arm_min_length, stalk_max_length, complement_table);
+			} });
+	}
+
+	// A tandem stage that enforces needs its unit; one that excludes has nothing to exclude without it.
+	auto tandem_stage = [&](string name, FilterStatus status, int min_unit, int unit_copies, bool of_arms) {
+		if (status == FilterStatus::Ignore) {
+			return;
+		}
+		if (status == FilterStatus::Enforce) {
+			if (min_unit < 1) {
+				Error().Fatal("Tandem min unit should be >1 but is " + to_string(min_unit));
+			}
+			if (unit_copies < 1) {
+				Error().Fatal("Tandem unit copies should be positive but is " + to_string(unit_copies));
+			}
+			if (unit_copies == 1) {
+				Error().Warn("Tandem that requires just 1 copy imposes no additional constraints");
+				return;
+			}
+		}
+		else if (min_unit < 1 || unit_copies <= 1) {
+			return;
+		}
+		if (!of_arms) {
+			stages.push_back({ name, status,
+				[=](string_view seq) {
+					return is_tandem(seq, min_unit, unit_copies);
+				} });
+			return;
+		}
+		stages.push_back({ name, status,
+			[=](string_view seq) {
+				if (!is_palindrome(seq, arm_min_length, stalk_max_length, complement_table)) {
+					return false;
+				}
+				auto arm_length = palindrome_arm_length(seq, complement_table);
+				return is_tandem(seq.substr(0, arm_length), min_unit, unit_copies);
+			} });
+	};
+	tandem_stage("tandems", config.tandem_status, config.tandem_min_unit, config.tandem_unit_copies, false);
+	tandem_stage("palindromes with tandem arms", config.palindrome_arm_tandem_status,
+		config.palindrome_arm_tandem_min_unit, config.palindrome_arm_tandem_unit_copies, true);
+} // FamilyFilter()
+
+bool FamilyFilter::Keep(string_view seq) const
+{
+	for (auto const& stage : stages) {
+		if (stage.test(seq) != (stage.status == FilterStatus::Enforce)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+string FamilyFilter::Description() const
+{
+	string description;
+	for (auto const& stage : stages) {
+		if (!description.empty()) {
+			description += ", ";
+		}
+		description += (stage.status == FilterStatus::Exclude ? "no " : "") + stage.name;
+	}
+	return description;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+#include "Config.h"
+#include "FilterStatus.h"
+
+using namespace std;
+
+/*
+* The filters on the families found, each one a stage with its FilterStatus from config:
+*	- palindrome_status: the sequence is a palindrome, see is_palindrome();
+*	- tandem_status: the sequence is a tandem, see is_tandem();
+*	- palindrome_arms_tandems_status: the sequence is a palindrome whose arm is a tandem
+*	  of palindrome_arm_tandem_min_unit and palindrome_arm_tandem_unit_copies.
+* Enforce keeps only the families that pass the test, Exclude only the ones that fail it,
+* Ignore leaves the stage out. The deprecated palindromes=yes and tandems=yes stand for
+* palindrome_status=Enforce and tandem_status=Enforce, or Exclude with both of them, when the statuses are not set.
+* Keep() runs all the active stages on a sequence at once, so that one pass over the families does them all,
+* see RepeatFinder::FilterFamilies(). It only reads, and may be called from many threads.
+*/
+class FamilyFilter
+{
+public:
+	// complement_table: config's complement for every letter, used when the complement is defined.
+	FamilyFilter(Config config, const char* complement_table);
+
+	bool Active() const {
+		return !stages.empty();
+	}
+
+	bool Keep(string_view seq) const;
+
+	// The active stages, e.g. "palindromes, no tandems".
+	string Description() const;
+
+private:
+	struct Stage
+	{
+		string name;
+		FilterStatus status;
+		function<bool(string_view)> test;
+	};
+	vector<Stage> stages;
+};
+
+// How far the two ends of seq mirror each other (through complement_table, if not null),
+// at most half the length less one: the arm of the palindrome.
+size_t palindrome_arm_length(string_view seq, const char* complement_table);
+
+// True if and only if seq is an exact palindrome:
+// arms of at least arm_min_length and at most stalk_max_length letters between them.
+bool is_palindrome(string_view seq, streamsize arm_min_length, streamsize stalk_max_length, const char* complement_table);
+
+// True if and only if seq is unit_copies or more copies of a unit of at least min_unit letters,
+// case insensitive.
+bool is_tandem(string_view seq, int min_unit, int unit_copies);
@@ -0,0 +1,82 @@
+#include <regex>
+#include <cctype>
+
+#include "FastaFile.h"
+#include "InputReader.h"
+
+using namespace std;
+
+void FastaFile::Load(string filename)
+{
+	this->filename = filename;
+	packed.reset();
+
+	// Plain or gzip, decompressed on the reader's thread while the data is taken in here.
+	InputReader is(filename);
+
+	// Skip the header, if any.
+	header = "";
+	string line;
+	sequence_name = "";
+	const regex origin_shift(".*\\brange=(\\w+):(\\d+)-.*", regex::icase);
+	const regex first_word(">\\s*(\\S+).*");
+	smatch matching_pieces;
+	while (is.HeaderLine(line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		header += line + "\n";
+		// Extract values from the header.
+		if (sequence_name.empty() && regex_match(line, matching_pieces, first_word)) {
+			sequence_name = matching_pieces[1].str();
+		}
+		if (!regex_match(line, matching_pieces, origin_shift)) {
+			continue;
+		}
+		sequence_name = matching_pieces[1].str();
+		auto piece = matching_pieces[2].str();
+		absolute_origin = stoll(piece);
+	}
+
+	// The sequence will contain all the data from the file,
+	// less the number of control characters.
+	// It grows as the blocks come, since a compressed or piped input has no size to go by.
+	sequence.clear();
+	sequence.reserve(is.SizeHint());
+
+	string block;
+	while (is.Next(block)) {
+		// The runs between nonprintable characters, e.g. the lines, are appended whole.
+		size_t run_start = 0;
+		for (size_t i = 0; i < block.size(); ++i) {
+			if (iscntrl((unsigned char)block[i])) {
+				sequence.append(block, run_start, i - run_start);
+				run_start = i + 1;
+			}
+		}
+		sequence.append(block, run_start, string::npos);
+	}
+} // Load()
+
+void FastaFile::LoadPacked(string packed_filename)
+{
+	packed = make_shared<PackedFasta>();
+	packed->Open(packed_filename);
+	filename = packed->SourceFilename();
+	header = packed->FastaHeader();
+	sequence_name = packed->SequenceName();
+	absolute_origin = (streamsize)packed->Header().absolute_origin;
+	packed->Unpack(sequence);
+}
+
+bool is_fasta_file_name(const string& filename)
+{
+	static const regex regex_fa(".+\\.(fa|fasta)(\\.gz)?", regex::icase);
+	return regex_match(filename, regex_fa);
+}
+
+bool is_gzip_file_name(const string& filename)
+{
+	static const regex regex_gz(".+\\.gz", regex::icase);
+	return regex_match(filename, regex_gz);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <ios>
+#include <memory>
+
+#include "PackedFasta.h"
+
+using namespace std;
+
+/*
+* An input FASTA file held in memory.
+*/
+struct FastaFile
+{
+	string filename;
+	string header; // all the header lines, if any
+	streamsize absolute_origin = 0; // from the range=chr:start-end part of the header
+	string sequence_name; // the chr of range=chr:start-end, else the first word of the header, if any
+	string sequence; // the data, without the control characters
+	shared_ptr<PackedFasta> packed; // the .t24p file the data was reloaded from, if it was
+
+
+	// Read the whole file, plain or gzip, or the standard input for "-" (see InputReader.h);
+	// fatal if it cannot be read.
+	void Load(string filename);
+
+	// Reload a file from its .t24p file; filename becomes that of the FASTA file it was packed from.
+	void LoadPacked(string packed_filename);
+};
+
+// The input files of a folder: .fa or .fasta, either of them possibly .gz.
+bool is_fasta_file_name(const string& filename);
+
+bool is_gzip_file_name(const string& filename);
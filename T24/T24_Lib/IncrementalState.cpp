@@ -0,0 +1,322 @@
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+#include "IncrementalState.h"
+#include "NBlockIndex.h"
+#include "ShardFile.h"
+#include "ResultFile.h"
+#include "RepeatOutputs.h"
+#include "TextOutput.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+static const char state_magic[4] = { 'T', '2', '4', 'I' };
+static const uint32_t state_version = 1;
+
+uint64_t window_key(string_view seq)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (auto c : seq) {
+		h ^= (unsigned char)c;
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
+
+string state_file_name(Config config, Process_Type pt, string filename)
+{
+	string prefix = pt == Process_Type::fpt ? "fpt_" : "crd_";
+	auto output_filename = prefix + output_basename(config, filename) + ".t24i";
+	return (fs::path(config.output_folder_name) /= output_filename).string();
+}
+
+// Everything in config that decides which families there are, apart from the header fields.
+static uint32_t settings_checksum(Config config)
+{
+	string letters(config.letters.begin(), config.letters.end());
+	sort(letters.begin(), letters.end());
+	vector<string> pairs;
+	for (auto const& [x, y] : config.complement) {
+		pairs.push_back(string(1, x) + y);
+	}
+	sort(pairs.begin(), pairs.end());
+
+	auto settings = letters + "|";
+	// The filters with their statuses, see FamilyFilter.h.
+	if (config.palindrome_status != FilterStatus::Ignore || config.palindrome_arm_tandem_status != FilterStatus::Ignore) {
+		settings += "palindromes " + string(1, (char)config.palindrome_status)
+			+ " " + to_string(config.palindrome_arm) + " " + to_string(config.palindrome_center) + "|";
+		for (auto const& p : pairs) {
+			settings += p;
+		}
+	}
+	if (config.tandem_status != FilterStatus::Ignore) {
+		settings += "|tandems " + string(1, (char)config.tandem_status)
+			+ " " + to_string(config.tandem_min_unit) + " " + to_string(config.tandem_unit_copies);
+	}
+	if (config.palindrome_arm_tandem_status != FilterStatus::Ignore) {
+		settings += "|arm tandems " + string(1, (char)config.palindrome_arm_tandem_status)
+			+ " " + to_string(config.palindrome_arm_tandem_min_unit) + " " + to_string(config.palindrome_arm_tandem_unit_copies);
+	}
+	return crc32(settings.data(), settings.size());
+}
+
+// The windows of the first phase with check positions from check_from on,
+// i.e. the sequences of length min_length that end there and have no N letters.
+static vector<WindowEntry> find_windows(Config config, string_view sequence, streamsize min_length, streamsize check_from)
+{
+	vector<WindowEntry> windows;
+	check_from = max(check_from, min_length);
+
+	// Run by run of meaningful letters, as in the first phase, over the letters the windows can have.
+	auto from = min(check_from - min_length + 1, (streamsize)sequence.size());
+	NBlockIndex nblocks(sequence.substr((size_t)from), config);
+	for (auto const& run : nblocks.Runs()) {
+		for (auto check_position = max(from + run.start + min_length - 1, check_from); check_position < from + run.end; ++check_position) {
+			auto position = check_position - min_length;
+			windows.push_back({ window_key(sequence.substr(position + 1, min_length)), (uint64_t)position });
+		}
+	}
+	sort(windows.begin(), windows.end(), [](const WindowEntry& a, const WindowEntry& b) {
+		return a.key < b.key || (a.key == b.key && a.position < b.position);
+	});
+	return windows;
+}
+
+/*
+* Write the state file: the windows of old_windows (from the previous state) and new_windows merged,
+* under a temporary name, renamed by the caller once the previous state is closed.
+*/
+static void write_state(Config config, Process_Type pt, const FastaFile& input, const RepeatFinder& finder,
+	const WindowEntry* old_windows, size_t old_count, const vector<WindowEntry>& new_windows, string output_filename)
+{
+	auto entries = family_entries(finder);
+	auto& statistics = finder.Statistics();
+
+	StateHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, state_magic, sizeof(header.magic));
+	header.version = state_version;
+	header.process_type = (uint32_t)pt;
+	header.copy_number = pt == Process_Type::fpt ? config.fpt_copy_number : config.crd_copy_number;
+	header.min_repeat_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	header.sequence_size = input.sequence.size();
+	header.meaningful_letters = statistics.meaningful_letters;
+	header.windows = statistics.windows;
+	header.max_repeat_length = statistics.max_repeat_length;
+	header.window_count = old_count + new_windows.size();
+	header.family_count = entries.size();
+	header.sequence_checksum = crc32(input.sequence.data(), input.sequence.size());
+	header.settings_checksum = settings_checksum(config);
+	header.families_checksum = crc32(entries.data(), entries.size() * sizeof(ShardEntry));
+	header.header_checksum = crc32(&header, offsetof(StateHeader, header_checksum));
+
+	ensure_output_folder(config);
+	ofstream os(output_filename, ios::binary | ios::trunc);
+	if (!os) {
+		Error().Fatal("Cannot open for writing file: " + output_filename);
+	}
+	os.write((const char*)&header, sizeof(header));
+
+	// Merge the two sorted lists of windows, a buffer at a time.
+	auto before = [](const WindowEntry& a, const WindowEntry& b) {
+		return a.key < b.key || (a.key == b.key && a.position < b.position);
+	};
+	vector<WindowEntry> buffer;
+	buffer.reserve(1 << 16);
+	size_t i = 0, j = 0;
+	while (i < old_count || j < new_windows.size()) {
+		if (j == new_windows.size() || (i < old_count && before(old_windows[i], new_windows[j]))) {
+			buffer.push_back(old_windows[i++]);
+		}
+		else {
+			buffer.push_back(new_windows[j++]);
+		}
+		if (buffer.size() == buffer.capacity()) {
+			os.write((const char*)buffer.data(), buffer.size() * sizeof(WindowEntry));
+			buffer.clear();
+		}
+	}
+	os.write((const char*)buffer.data(), buffer.size() * sizeof(WindowEntry));
+
+	os.write((const char*)entries.data(), entries.size() * sizeof(ShardEntry));
+	os.close();
+	if (!os) {
+		Error().Fatal("Cannot write file: " + output_filename);
+	}
+}
+
+void write_state_file(Config config, Process_Type pt, const FastaFile& input, const RepeatFinder& finder)
+{
+	auto output_filename = state_file_name(config, pt, input.filename);
+	std::cout << "Generating " << output_filename << "...";
+
+	auto min_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	auto windows = find_windows(config, input.sequence, min_length, 0);
+	write_state(config, pt, input, finder, nullptr, 0, windows, output_filename + ".tmp");
+	fs::rename(output_filename + ".tmp", output_filename);
+
+	std::cout << endl;
+}
+
+bool update_from_state(Config config, Process_Type pt, const FastaFile& input)
+{
+	auto filename = state_file_name(config, pt, input.filename);
+	if (!fs::exists(filename)) {
+		return false;
+	}
+
+	auto stopwatch_start = chrono::high_resolution_clock::now();
+
+	auto min_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	auto copy_number = pt == Process_Type::fpt ? config.fpt_copy_number : config.crd_copy_number;
+	auto& sequence = input.sequence;
+
+	// Check the state against config and the input.
+	MappedFile mapped;
+	mapped.Open(filename);
+	auto header = (const StateHeader*)mapped.Data();
+	string unusable;
+	if (mapped.Size() < sizeof(StateHeader) || memcmp(header->magic, state_magic, sizeof(state_magic)) != 0
+		|| header->version != state_version
+		|| header->header_checksum != crc32(header, offsetof(StateHeader, header_checksum))
+		|| mapped.Size() != sizeof(StateHeader)
+			+ header->window_count * sizeof(WindowEntry) + header->family_count * sizeof(ShardEntry)) {
+		unusable = "it is damaged or of another version";
+	}
+	else if (header->process_type != (uint32_t)pt || header->min_repeat_length != (uint64_t)min_length
+		|| header->copy_number != copy_number || header->settings_checksum != settings_checksum(config)) {
+		unusable = "it was written with another configuration";
+	}
+	else if (header->sequence_size > sequence.size()
+		|| header->sequence_checksum != crc32(sequence.data(), (size_t)header->sequence_size)) {
+		unusable = "the input has changed other than by appending";
+	}
+	if (!unusable.empty()) {
+		Error().Warn("Cannot update from " + filename + ": " + unusable + ". Analyzing the whole input instead.");
+		return false;
+	}
+
+	auto old_size = (streamsize)header->sequence_size;
+	auto size = (streamsize)sequence.size();
+	std::cout << endl << "-- -- -- -- -- --\nInput file " << input.filename
+		<< ", updating from " << filename << " with " << size - old_size << " new letters" << endl;
+
+	config.absolute_origin = input.absolute_origin;
+
+	auto index = (const WindowEntry*)(mapped.Data() + sizeof(StateHeader));
+	auto index_count = (size_t)header->window_count;
+	auto old_families = (const ShardEntry*)(mapped.Data() + sizeof(StateHeader) + index_count * sizeof(WindowEntry));
+	auto old_family_count = (size_t)header->family_count;
+	if (header->families_checksum != crc32(old_families, old_family_count * sizeof(ShardEntry))) {
+		Error().Fatal("State file is damaged: " + filename);
+	}
+
+	RepeatStatistics statistics;
+	statistics.meaningful_letters = (size_t)header->meaningful_letters
+		+ (size_t)NBlockIndex(sequence.substr((size_t)min(max(min_length, old_size), size)), config).CountFrom(0);
+	statistics.windows = max((streamsize)0, size - min_length);
+
+	// The sequences whose families have to be extended again, with their new copies:
+	// all the new windows, and the old ones close enough to the old end
+	// for their families to have been stopped by it.
+	auto new_windows = find_windows(config, sequence, min_length, old_size);
+	SequenceTable<vector<streamsize>> touched(sequence);
+	for (auto const& w : new_windows) {
+		touched[string_view(sequence).substr((size_t)w.position + 1, (size_t)min_length)].push_back((streamsize)w.position);
+	}
+	auto near_end = max((streamsize)0, old_size - (streamsize)header->max_repeat_length - 1);
+	for (auto const& w : find_windows(config, string_view(sequence).substr(0, (size_t)old_size), min_length,
+		near_end + min_length)) {
+		touched[string_view(sequence).substr((size_t)w.position + 1, (size_t)min_length)];
+	}
+
+	// Their copies in the old part, from the index; the families these started are dropped.
+	unordered_set<streamsize> dropped_starts;
+	SequenceTable<PositionList> seeds(sequence);
+	for (auto& [seq, new_positions] : touched) {
+		WindowEntry probe = { window_key(seq), 0 };
+		auto first = lower_bound(index, index + index_count, probe, [](const WindowEntry& a, const WindowEntry& b) {
+			return a.key < b.key;
+		});
+		vector<streamsize> positions;
+		for (auto w = first; w != index + index_count && w->key == probe.key; ++w) {
+			if (sequence.compare((size_t)w->position + 1, (size_t)min_length, seq) == 0) {
+				positions.push_back((streamsize)w->position);
+				dropped_starts.insert((streamsize)w->position);
+			}
+		}
+		sort(new_positions.begin(), new_positions.end());
+		positions.insert(positions.end(), new_positions.begin(), new_positions.end());
+		if (positions.size() >= copy_number) {
+			auto& seed = seeds[seq];
+			for (auto p : positions) {
+				seed.Add(p);
+			}
+		}
+	}
+	touched.Clear();
+
+	// All the other families stay as they were.
+	FamilyLevels families;
+	size_t kept = 0;
+	for (size_t i = 0; i < old_family_count; ++i) {
+		auto& entry = old_families[i];
+		if (dropped_starts.count((streamsize)entry.start) > 0) {
+			continue;
+		}
+		++kept;
+		// The first phase registers a sequence at the position right before it.
+		auto shift = (streamsize)entry.length == min_length ? 1 : 0;
+		level_of(families, (streamsize)entry.length, sequence)
+			[string_view(sequence).substr((size_t)entry.start + shift, (size_t)entry.length)].Add((streamsize)entry.start);
+	}
+	dropped_starts.clear();
+
+	std::cout << seeds.Size() << " sequences of length " << min_length << " to extend again, "
+		<< kept << " of " << old_family_count << " copies of families kept from the previous run" << endl;
+
+	RepeatFinder finder(config, pt);
+	finder.keep_families = true; // for the new state
+	ProgressReporter reporter(finder.progress, config.progress_interval,
+		input.filename + (pt == Process_Type::fpt ? " fpt" : " crd") + " update");
+	RepeatOutputs outputs(config, pt, input);
+	outputs.Connect(finder);
+
+	finder.SetFamilies(sequence, move(families), statistics);
+	try {
+		finder.ExtendSeeds(move(seeds));
+		finder.FinishFamilies();
+	}
+	catch (const Cancelled&) {
+		outputs.Discard();
+		throw;
+	}
+
+	outputs.Finish(finder.Statistics());
+
+	// The new state, replacing the old one once that is closed.
+	std::cout << "Generating " << filename << "...";
+	write_state(config, pt, input, finder, index, index_count, new_windows, filename + ".tmp");
+	mapped.Close();
+	fs::rename(filename + ".tmp", filename);
+	std::cout << endl;
+
+	// Execution time.
+	auto stopwatch_finish = chrono::high_resolution_clock::now();
+	auto stopwatch_elapsed = stopwatch_finish - stopwatch_start;
+	auto milliseconds = (long)(stopwatch_elapsed.count() / 1000000);
+	auto seconds = (int)round(milliseconds / 1000.0);
+	std::cout << endl
+		<< "Update took " << seconds << " seconds on file " << input.filename << endl;
+	return true;
+}
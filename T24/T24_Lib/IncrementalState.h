@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "Config.h"
+#include "FastaFile.h"
+#include "RepeatFinder.h"
+
+using namespace std;
+
+/*
+* Incremental runs, for input files that grow by appending: new scaffolds, contigs.
+* With config.please_update_incrementally, every run leaves a state file next to its outputs,
+* and the next run on a longer version of the same input only analyzes what the new letters change:
+*	- the sequences of the minimum length that got new copies,
+*	- the ones whose copies reached the old end, since they may now go on beyond it;
+* the families of those are extended again on the whole input, all the others are taken
+* from the state file as they are. Then the filters, culling and output files are done as usual.
+* The window index is read through a memory mapping and searched, not loaded,
+* so the work on it is in proportion to the new letters.
+*
+* State file (.t24i), little endian:
+*	header		StateHeader
+*	windows		WindowEntry, sorted by key, then by position:
+*				every sequence of the minimum length in the input, as the first phase sees it
+*	families	ShardEntry, sorted by length, then by start:
+*				the families after the filters, as in RepeatFinder::Families()
+*/
+
+struct StateHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t process_type; // Process_Type
+	uint32_t copy_number;
+	uint64_t min_repeat_length;
+	uint64_t sequence_size; // of the input analyzed so far
+	uint64_t meaningful_letters;
+	uint64_t windows;
+	uint64_t max_repeat_length;
+	uint64_t window_count;
+	uint64_t family_count;
+	uint32_t sequence_checksum; // the input must still start with the same letters
+	uint32_t settings_checksum; // letters and filters, which decide what the families are
+	uint32_t families_checksum;
+	uint32_t header_checksum; // of all the bytes above
+};
+
+struct WindowEntry
+{
+	uint64_t key; // window_key() of the sequence
+	uint64_t position; // as in the first phase: the sequence starts right after it
+};
+
+// Key of a sequence of the minimum length in the window index (FNV-1a, 64 bits).
+// Sequences with the same key are told apart by their letters.
+uint64_t window_key(string_view seq);
+
+// Output/{fpt_|crd_}{basename}.t24i
+string state_file_name(Config config, Process_Type pt, string filename);
+
+// After a full run: the state for the next incremental one.
+void write_state_file(Config config, Process_Type pt, const FastaFile& input, const RepeatFinder& finder);
+
+// Update the results of the previous run on input, if it left a state file that input extends:
+// write the output files and the new state file, and return true.
+// Otherwise return false, with a warning if the state file is there but cannot be used.
+bool update_from_state(Config config, Process_Type pt, const FastaFile& input);
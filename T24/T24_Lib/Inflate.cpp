@@ -0,0 +1,446 @@
+#include <cstring>
+#include <algorithm>
+
+#include "Inflate.h"
+#include "Crc32.h"
+#include "Error.h"
+
+using namespace std;
+
+static const size_t history = 32768; // the farthest a match may copy from
+static const size_t longest_match = 258;
+
+static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+Inflater::Inflater(function<size_t(char*, size_t)> read, function<void(string&&)> emit)
+	: read(read), emit(emit)
+{
+}
+
+bool Inflater::IsGzip(const char* data, size_t size)
+{
+	return size >= 2 && (unsigned char)data[0] == 0x1F && (unsigned char)data[1] == 0x8B;
+}
+
+void Inflater::Run()
+{
+	input.resize(1 << 16);
+	window.resize(history + block_size + longest_match + 8);
+
+	for (bool first = true; first || !AtEnd(); first = false) {
+		auto id1 = Bits(8);
+		auto id2 = Bits(8);
+		if (id1 != 0x1F || id2 != 0x8B) {
+			if (first) {
+				Error().Fatal("Gzip data: not a gzip file.");
+			}
+			Error().Warn("Gzip data: ignored what follows the last member.");
+			break;
+		}
+		Member();
+	}
+	Flush(true);
+} // Run()
+
+void Inflater::Member()
+{
+	if (Bits(8) != 8) {
+		Error().Fatal("Gzip data: unknown compression method.");
+	}
+	auto flags = Bits(8);
+	Bits(16); // modification time
+	Bits(16);
+	Bits(8); // extra flags
+	Bits(8); // operating system
+	if (flags & 4) {
+		auto extra_length = Bits(16);
+		for (uint32_t i = 0; i < extra_length; ++i) {
+			Bits(8);
+		}
+	}
+	if (flags & 8) {
+		while (Bits(8) != 0) { // file name
+		}
+	}
+	if (flags & 16) {
+		while (Bits(8) != 0) { // comment
+		}
+	}
+	if (flags & 2) {
+		Bits(16); // header CRC
+	}
+
+	Check();
+	crc = 0;
+	member_size = 0;
+
+	Huffman lengths, distances;
+	for (bool last = false; !last; ) {
+		last = Bits(1) != 0;
+		switch (Bits(2)) {
+		case 0:
+			Stored();
+			break;
+		case 1:
+			if (fixed_lengths.table.empty()) {
+				uint8_t fixed[288];
+				fill(fixed, fixed + 144, 8);
+				fill(fixed + 144, fixed + 256, 9);
+				fill(fixed + 256, fixed + 280, 7);
+				fill(fixed + 280, fixed + 288, 8);
+				Build(fixed_lengths, fixed, 288);
+				fill(fixed, fixed + 30, 5);
+				Build(fixed_distances, fixed, 30);
+			}
+			Codes(fixed_lengths, fixed_distances);
+			break;
+		case 2:
+			Dynamic(lengths, distances);
+			Codes(lengths, distances);
+			break;
+		default:
+			Error().Fatal("Gzip data: invalid block type.");
+		}
+	}
+
+	// The trailer: CRC-32 and size of the decompressed data.
+	AlignToByte();
+	Check();
+	auto crc_low = Bits(16);
+	auto crc_high = Bits(16);
+	auto size_low = Bits(16);
+	auto size_high = Bits(16);
+	if (padding * 8 > (size_t)bit_count) {
+		Error().Fatal("Gzip data: the file ends too early.");
+	}
+	if ((crc_low | crc_high << 16) != crc || (size_low | size_high << 16) != member_size) {
+		Error().Fatal("Gzip data: the data is damaged (CRC or size does not match).");
+	}
+} // Member()
+
+void Inflater::Stored()
+{
+	AlignToByte();
+	auto length = Bits(16);
+	auto complement = Bits(16);
+	if (length != (~complement & 0xFFFF)) {
+		Error().Fatal("Gzip data: invalid stored block.");
+	}
+	while (length > 0) {
+		if (window_end >= history + block_size) {
+			Flush(false);
+		}
+		// What Need() has taken from the input already.
+		if (bit_count > 0) {
+			window[window_end++] = (char)Bits(8);
+			--length;
+			continue;
+		}
+		if (input_next == input_end && !Refill()) {
+			Error().Fatal("Gzip data: the file ends too early.");
+		}
+		auto n = min({ (size_t)length, input_end - input_next, window.size() - window_end });
+		memcpy(&window[window_end], &input[input_next], n);
+		window_end += n;
+		input_next += n;
+		length -= (uint32_t)n;
+	}
+} // Stored()
+
+void Inflater::Codes(const Huffman& lengths, const Huffman& distances)
+{
+	// The state is taken into locals for the loop, since the writes to the window as chars
+	// would otherwise make the compiler read the members again after every byte.
+	auto out = window.data();
+	auto end = window_end;
+	auto in_bits = bits;
+	auto in_count = bit_count;
+	auto length_table = lengths.table.data();
+	auto length_mask = (1u << lengths.max_length) - 1;
+	auto distance_table = distances.table.data();
+	auto distance_mask = (1u << distances.max_length) - 1;
+
+	auto need = [&](int n) {
+		if (in_count >= n) {
+			return;
+		}
+		bits = in_bits;
+		bit_count = in_count;
+		Need(n);
+		in_bits = bits;
+		in_count = bit_count;
+	};
+	auto take = [&](int n) {
+		need(n);
+		auto value = (uint32_t)(in_bits & ((1u << n) - 1));
+		in_bits >>= n;
+		in_count -= n;
+		return value;
+	};
+	auto decode = [&](const uint16_t* table, uint32_t mask, int max_length) {
+		need(max_length);
+		auto entry = table[in_bits & mask];
+		int length = entry & 15;
+		if (length == 0) {
+			Error().Fatal("Gzip data: invalid code.");
+		}
+		in_bits >>= length;
+		in_count -= length;
+		return entry >> 4;
+	};
+
+	for (;;) {
+		if (end >= history + block_size) {
+			window_end = end;
+			Flush(false);
+			end = window_end;
+		}
+		auto symbol = decode(length_table, length_mask, lengths.max_length);
+		if (symbol < 256) {
+			out[end++] = (char)symbol;
+			continue;
+		}
+		if (symbol == 256) {
+			break;
+		}
+		symbol -= 257;
+		if (symbol >= 29) {
+			Error().Fatal("Gzip data: invalid length code.");
+		}
+		auto length = length_base[symbol] + take(length_extra[symbol]);
+
+		auto code = decode(distance_table, distance_mask, distances.max_length);
+		if (code >= 30) {
+			Error().Fatal("Gzip data: invalid distance code.");
+		}
+		size_t distance = distance_base[code] + take(distance_extra[code]);
+		if (distance > end) {
+			Error().Fatal("Gzip data: distance too far back.");
+		}
+
+		// Eight bytes a step when they do not overlap, the last step possibly past the match
+		// (the window has room for it); else byte by byte, e.g. for a run of one letter.
+		auto to = out + end;
+		auto from = to - distance;
+		if (distance >= 8) {
+			for (uint32_t i = 0; i < length; i += 8) {
+				memcpy(to + i, from + i, 8);
+			}
+		}
+		else {
+			for (uint32_t i = 0; i < length; ++i) {
+				to[i] = from[i];
+			}
+		}
+		end += length;
+	}
+
+	window_end = end;
+	bits = in_bits;
+	bit_count = in_count;
+} // Codes()
+
+void Inflater::Dynamic(Huffman& lengths, Huffman& distances)
+{
+	static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	int length_count = Bits(5) + 257;
+	int distance_count = Bits(5) + 1;
+	int code_count = Bits(4) + 4;
+	if (length_count > 286 || distance_count > 30) {
+		Error().Fatal("Gzip data: invalid code counts.");
+	}
+
+	uint8_t code_lengths[19] = {};
+	for (int i = 0; i < code_count; ++i) {
+		code_lengths[order[i]] = (uint8_t)Bits(3);
+	}
+	Huffman code;
+	Build(code, code_lengths, 19);
+
+	// The code lengths of both codes, run-length encoded with the code above.
+	uint8_t all_lengths[286 + 30] = {};
+	auto total = length_count + distance_count;
+	for (int i = 0; i < total; ) {
+		auto symbol = Decode(code);
+		if (symbol < 16) {
+			all_lengths[i++] = (uint8_t)symbol;
+			continue;
+		}
+		uint8_t value = 0;
+		int repeat;
+		if (symbol == 16) {
+			if (i == 0) {
+				Error().Fatal("Gzip data: repeated code length without a previous one.");
+			}
+			value = all_lengths[i - 1];
+			repeat = 3 + Bits(2);
+		}
+		else if (symbol == 17) {
+			repeat = 3 + Bits(3);
+		}
+		else {
+			repeat = 11 + Bits(7);
+		}
+		if (i + repeat > total) {
+			Error().Fatal("Gzip data: too many code lengths.");
+		}
+		while (repeat-- > 0) {
+			all_lengths[i++] = value;
+		}
+	}
+	if (all_lengths[256] == 0) {
+		Error().Fatal("Gzip data: no end of block code.");
+	}
+
+	Build(lengths, all_lengths, length_count);
+	Build(distances, all_lengths + length_count, distance_count);
+} // Dynamic()
+
+void Inflater::Build(Huffman& code, const uint8_t* lengths, int n)
+{
+	int count[16] = {};
+	for (int symbol = 0; symbol < n; ++symbol) {
+		++count[lengths[symbol]];
+	}
+	count[0] = 0;
+
+	code.max_length = 0;
+	int left = 1; // codes of the current length not used yet
+	for (int length = 1; length < 16; ++length) {
+		left = (left << 1) - count[length];
+		if (left < 0) {
+			Error().Fatal("Gzip data: over-subscribed code.");
+		}
+		if (count[length] > 0) {
+			code.max_length = length;
+		}
+	}
+
+	// The codes of every length follow those of the shorter ones;
+	// in the table they are bit-reversed, since the input is read from the lowest bit.
+	int next[16] = {};
+	for (int length = 1, first = 0; length < 16; ++length) {
+		first = (first + count[length - 1]) << 1;
+		next[length] = first;
+	}
+	code.table.assign((size_t)1 << code.max_length, 0);
+	for (int symbol = 0; symbol < n; ++symbol) {
+		int length = lengths[symbol];
+		if (length == 0) {
+			continue;
+		}
+		auto canonical = next[length]++;
+		size_t reversed = 0;
+		for (int bit = 0; bit < length; ++bit) {
+			reversed |= (size_t)((canonical >> bit) & 1) << (length - 1 - bit);
+		}
+		for (auto i = reversed; i < code.table.size(); i += (size_t)1 << length) {
+			code.table[i] = (uint16_t)(symbol << 4 | length);
+		}
+	}
+} // Build()
+
+int Inflater::Decode(const Huffman& code)
+{
+	Need(code.max_length);
+	auto entry = code.table[bits & ((1u << code.max_length) - 1)];
+	int length = entry & 15;
+	if (length == 0) {
+		Error().Fatal("Gzip data: invalid code.");
+	}
+	bits >>= length;
+	bit_count -= length;
+	return entry >> 4;
+}
+
+bool Inflater::Refill()
+{
+	input_next = 0;
+	input_end = read(input.data(), input.size());
+	return input_end > 0;
+}
+
+void Inflater::Need(int n)
+{
+	if (bit_count >= n) {
+		return;
+	}
+	// Whole bytes up to 63 bits at once, while the input has 8 bytes to read from.
+	if (input_end - input_next >= 8) {
+		uint64_t word;
+		memcpy(&word, &input[input_next], 8); // little-endian, as are the x86 and ARM targets
+		auto taken = (63 - bit_count) >> 3;
+		bits |= word << bit_count;
+		input_next += taken;
+		bit_count += taken * 8;
+		bits &= ((uint64_t)1 << bit_count) - 1;
+		return;
+	}
+	while (bit_count < n) {
+		uint64_t byte = 0;
+		if (input_next < input_end || Refill()) {
+			byte = (unsigned char)input[input_next++];
+		}
+		else if (++padding > 8) {
+			// More than the bit buffer holds: some of them were taken as data.
+			Error().Fatal("Gzip data: the file ends too early.");
+		}
+		bits |= byte << bit_count;
+		bit_count += 8;
+	}
+}
+
+uint32_t Inflater::Bits(int n)
+{
+	Need(n);
+	auto value = (uint32_t)(bits & ((1u << n) - 1));
+	bits >>= n;
+	bit_count -= n;
+	return value;
+}
+
+void Inflater::AlignToByte()
+{
+	auto n = bit_count % 8;
+	bits >>= n;
+	bit_count -= n;
+}
+
+bool Inflater::AtEnd()
+{
+	if ((size_t)bit_count > padding * 8 || input_next < input_end) {
+		return false;
+	}
+	return !Refill();
+}
+
+void Inflater::Check()
+{
+	crc = crc32(&window[checked], window_end - checked, crc);
+	member_size += (uint32_t)(window_end - checked);
+	checked = window_end;
+}
+
+void Inflater::Flush(bool all)
+{
+	Check();
+	if (window_end > emitted) {
+		emit(string(&window[emitted], window_end - emitted));
+	}
+	emitted = window_end;
+	if (all || window_end <= history) {
+		return;
+	}
+
+	// Keep the last 32 KB for the matches to come.
+	memmove(&window[0], &window[window_end - history], history);
+	window_end = emitted = checked = history;
+} // Flush()
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+/*
+* A gzip decompressor (RFC 1952 around RFC 1951 DEFLATE), so that .fa.gz files need no zlib.
+* The members of a multi-member file, as bgzip writes them, are decompressed one after the other
+* and their CRC-32 and sizes are checked; fatal if the data is not gzip or is damaged.
+* The compressed bytes are pulled from read, which returns 0 at the end,
+* and the decompressed ones are pushed to emit in blocks of about block_size bytes.
+*/
+class Inflater
+{
+public:
+	static const size_t block_size = 1 << 20;
+
+	Inflater(function<size_t(char*, size_t)> read, function<void(string&&)> emit);
+
+	// All the members, up to the end of the input.
+	void Run();
+
+	// True if the bytes start like a gzip member.
+	static bool IsGzip(const char* data, size_t size);
+
+private:
+	// Canonical Huffman code as a table indexed by the next max_length bits:
+	// symbol << 4 | code length, 0 for bits that are no code.
+	struct Huffman
+	{
+		vector<uint16_t> table;
+		int max_length = 0;
+	};
+
+	function<size_t(char*, size_t)> read;
+	function<void(string&&)> emit;
+
+	vector<char> input;
+	size_t input_next = 0, input_end = 0;
+	size_t padding = 0; // zero bytes given past the end of the input
+
+	uint64_t bits = 0; // the next bit_count bits of the input, the first one lowest
+	int bit_count = 0;
+
+	// The output: the last 32 KB already emitted, for the matches to copy from, then the new bytes.
+	vector<char> window;
+	size_t window_end = 0;
+	size_t emitted = 0; // window[emitted, window_end) is yet to be emitted
+	size_t checked = 0; // window[checked, window_end) is yet to be added to crc
+	uint32_t crc = 0;
+	uint32_t member_size = 0; // modulo 2^32, as in the trailer
+
+	Huffman fixed_lengths, fixed_distances; // built at the first block that uses them
+
+	bool Refill();
+	void Need(int n);
+	uint32_t Bits(int n);
+	void AlignToByte();
+	bool AtEnd();
+
+	void Member();
+	void Stored();
+	void Codes(const Huffman& lengths, const Huffman& distances);
+	void Dynamic(Huffman& lengths, Huffman& distances);
+	static void Build(Huffman& code, const uint8_t* lengths, int n);
+	int Decode(const Huffman& code);
+
+	void Check();
+	void Flush(bool all);
+};
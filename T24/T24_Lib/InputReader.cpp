@@ -0,0 +1,195 @@
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+
+#include "InputReader.h"
+#include "Inflate.h"
+#include "Error.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+using namespace std;
+namespace fs = filesystem;
+
+const string InputReader::standard_input = "-";
+
+// Thrown in the thread when the reader goes away before the end.
+struct ReaderClosed
+{
+};
+
+InputReader::InputReader(string filename)
+	: filename(filename)
+{
+	if (filename == standard_input) {
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		is = &cin;
+	}
+	else {
+		file = make_unique<ifstream>(filename, ios::binary);
+		if (!*file) {
+			Error().Fatal("Cannot open for reading file: " + filename);
+		}
+		is = file.get();
+	}
+
+	first_block.resize(Inflater::block_size);
+	first_block.resize(ReadRaw(&first_block[0], first_block.size()));
+	compressed = Inflater::IsGzip(first_block.data(), first_block.size());
+
+	error_code ec;
+	if (!compressed && file && fs::is_regular_file(filename, ec)) {
+		size_hint = (size_t)fs::file_size(filename, ec);
+	}
+
+	producer = thread(&InputReader::Produce, this);
+}
+
+InputReader::~InputReader()
+{
+	{
+		lock_guard<mutex> lock(guard);
+		closing = true;
+	}
+	changed.notify_all();
+	producer.join();
+}
+
+size_t InputReader::ReadRaw(char* data, size_t size)
+{
+	is->read(data, size);
+	return (size_t)is->gcount();
+}
+
+void InputReader::Produce()
+{
+	try {
+		if (compressed) {
+			auto first_next = (size_t)0;
+			Inflater inflater(
+				[&](char* data, size_t size) {
+					// The block read to tell gzip comes first.
+					if (first_next < first_block.size()) {
+						auto n = min(size, first_block.size() - first_next);
+						first_block.copy(data, n, first_next);
+						first_next += n;
+						return n;
+					}
+					return ReadRaw(data, size);
+				},
+				[&](string&& block) {
+					Push(move(block));
+				});
+			inflater.Run();
+		}
+		else {
+			Push(move(first_block));
+			for (;;) {
+				string block(Inflater::block_size, '\0');
+				block.resize(ReadRaw(&block[0], block.size()));
+				if (block.empty()) {
+					break;
+				}
+				Push(move(block));
+			}
+		}
+	}
+	catch (const ReaderClosed&) {
+	}
+	catch (...) {
+		lock_guard<mutex> lock(guard);
+		failure = current_exception();
+	}
+
+	{
+		lock_guard<mutex> lock(guard);
+		finished = true;
+	}
+	changed.notify_all();
+} // Produce()
+
+void InputReader::Push(string&& block)
+{
+	if (block.empty()) {
+		return;
+	}
+	unique_lock<mutex> lock(guard);
+	changed.wait(lock, [&] { return blocks.size() < queue_capacity || closing; });
+	if (closing) {
+		throw ReaderClosed();
+	}
+	blocks.push_back(move(block));
+	lock.unlock();
+	changed.notify_all();
+}
+
+bool InputReader::Pop(string& block)
+{
+	unique_lock<mutex> lock(guard);
+	changed.wait(lock, [&] { return !blocks.empty() || finished; });
+	if (blocks.empty()) {
+		if (failure) {
+			rethrow_exception(failure);
+		}
+		return false;
+	}
+	block = move(blocks.front());
+	blocks.pop_front();
+	lock.unlock();
+	changed.notify_all();
+	return true;
+}
+
+// Something left in current, unless at the end.
+bool InputReader::Fill()
+{
+	while (current_next >= current.size()) {
+		if (!Pop(current)) {
+			current.clear();
+			current_next = 0;
+			return false;
+		}
+		current_next = 0;
+	}
+	return true;
+}
+
+bool InputReader::HeaderLine(string& line)
+{
+	if (!Fill() || current[current_next] != '>') {
+		return false;
+	}
+	line.clear();
+	while (Fill()) {
+		auto end = current.find('\n', current_next);
+		if (end != string::npos) {
+			line.append(current, current_next, end - current_next);
+			current_next = end + 1;
+			break;
+		}
+		line.append(current, current_next, string::npos);
+		current_next = current.size();
+	}
+	return true;
+}
+
+bool InputReader::Next(string& block)
+{
+	if (!Fill()) {
+		return false;
+	}
+	if (current_next == 0) {
+		block = move(current);
+	}
+	else {
+		block.assign(current, current_next, string::npos);
+	}
+	current.clear();
+	current_next = 0;
+	return true;
+}
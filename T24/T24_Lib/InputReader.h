@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+
+using namespace std;
+
+/*
+* Reads an input file, plain or gzip (see Inflate.h), or the standard input for the file name "-".
+* Gzip is told by the first bytes, not by the name, so that a pipe may be compressed too.
+* A thread of its own reads and decompresses the input into blocks of about a megabyte,
+* up to a few blocks ahead of the caller, so that decompression overlaps with what the caller does
+* with the blocks; its errors are fatal in the caller, at the next block.
+*/
+class InputReader
+{
+public:
+	static const string standard_input; // "-"
+
+	// Fatal if the file cannot be opened.
+	explicit InputReader(string filename);
+	~InputReader();
+
+	InputReader(const InputReader&) = delete;
+	InputReader& operator=(const InputReader&) = delete;
+
+	// The next leading line that starts with '>', without the line break;
+	// false once the next line does not.
+	bool HeaderLine(string& line);
+
+	// The next block of the data after the header lines; false at the end.
+	bool Next(string& block);
+
+	bool Compressed() const {
+		return compressed;
+	}
+
+	// Bytes of a plain file, for reserving; 0 when not known before the end.
+	size_t SizeHint() const {
+		return size_hint;
+	}
+
+private:
+	static const size_t queue_capacity = 4; // blocks
+
+	string filename;
+	unique_ptr<ifstream> file;
+	istream* is;
+	bool compressed = false;
+	size_t size_hint = 0;
+
+	string first_block; // read to tell gzip, for the thread to start with
+
+	string current; // the block being taken apart
+	size_t current_next = 0;
+
+	mutex guard;
+	condition_variable changed;
+	deque<string> blocks;
+	bool finished = false; // no more blocks will come
+	bool closing = false; // the reader goes away: the thread should stop
+	exception_ptr failure;
+	thread producer;
+
+	size_t ReadRaw(char* data, size_t size);
+	void Produce();
+	void Push(string&& block);
+	bool Pop(string& block);
+	bool Fill();
+};
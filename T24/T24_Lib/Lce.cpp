@@ -0,0 +1,291 @@
+#include <cstdint>
+
+#include "Lce.h"
+
+using namespace std;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LCE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC takes the intrinsics of any instruction set as they are; GCC and Clang want to be told per function.
+#if defined(LCE_X86) && !defined(_MSC_VER)
+#define LCE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define LCE_TARGET(isa)
+#endif
+
+static unsigned lowest_bit32(uint32_t x)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, x);
+	return (unsigned)index;
+#else
+	return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+static unsigned lowest_bit64(uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_IX86)
+	auto low = (uint32_t)x;
+	return low != 0 ? lowest_bit32(low) : 32 + lowest_bit32((uint32_t)(x >> 32));
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (unsigned)index;
+#else
+	return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+static size_t forward_scalar(const char* a, const char* b, size_t max)
+{
+	size_t i = 0;
+	while (i < max && a[i] == b[i]) {
+		++i;
+	}
+	return i;
+}
+
+static size_t mirror_scalar(const char* a, const char* b, size_t max)
+{
+	size_t i = 0;
+	while (i < max && a[i] == *(b - i)) {
+		++i;
+	}
+	return i;
+}
+
+#ifdef LCE_X86
+
+// The vector loops below compare full blocks, and leave the tail to the scalar loops.
+
+static size_t forward_sse2(const char* a, const char* b, size_t max)
+{
+	size_t i = 0;
+	for (; i + 16 <= max; i += 16) {
+		auto x = _mm_loadu_si128((const __m128i*)(a + i));
+		auto y = _mm_loadu_si128((const __m128i*)(b + i));
+		auto differ = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+		if (differ != 0) {
+			return i + lowest_bit32(differ);
+		}
+	}
+	return i + forward_scalar(a + i, b + i, max - i);
+}
+
+// The bytes of v in reverse order.
+static __m128i reverse_sse2(__m128i v)
+{
+	v = _mm_shuffle_epi32(v, 0x1B); // dwords
+	v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1); // words within dwords
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)); // bytes within words
+}
+
+static size_t mirror_sse2(const char* a, const char* b, size_t max)
+{
+	size_t i = 0;
+	for (; i + 16 <= max; i += 16) {
+		auto x = _mm_loadu_si128((const __m128i*)(a + i));
+		auto y = reverse_sse2(_mm_loadu_si128((const __m128i*)(b - i - 15)));
+		auto differ = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+		if (differ != 0) {
+			return i + lowest_bit32(differ);
+		}
+	}
+	return i + mirror_scalar(a + i, b - i, max - i);
+}
+
+LCE_TARGET("avx2")
+static size_t forward_avx2(const char* a, const char* b, size_t max)
+{
+	size_t i = 0;
+	for (; i + 32 <= max; i += 32) {
+		auto x = _mm256_loadu_si256((const __m256i*)(a + i));
+		auto y = _mm256_loadu_si256((const __m256i*)(b + i));
+		auto differ = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		if (differ != 0) {
+			return i + lowest_bit32(differ);
+		}
+	}
+	return i + forward_sse2(a + i, b + i, max - i);
+}
+
+LCE_TARGET("avx2")
+static size_t mirror_avx2(const char* a, const char* b, size_t max)
+{
+	const auto reverse = _mm256_setr_epi8(
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	size_t i = 0;
+	for (; i + 32 <= max; i += 32) {
+		auto x = _mm256_loadu_si256((const __m256i*)(a + i));
+		auto y = _mm256_loadu_si256((const __m256i*)(b - i - 31));
+		y = _mm256_permute2x128_si256(_mm256_shuffle_epi8(y, reverse), y, 0x01); // swap the halves too
+		auto differ = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		if (differ != 0) {
+			return i + lowest_bit32(differ);
+		}
+	}
+	return i + mirror_sse2(a + i, b - i, max - i);
+}
+
+LCE_TARGET("avx512f,avx512bw")
+static size_t forward_avx512(const char* a, const char* b, size_t max)
+{
+	size_t i = 0;
+	for (; i + 64 <= max; i += 64) {
+		auto x = _mm512_loadu_si512((const void*)(a + i));
+		auto y = _mm512_loadu_si512((const void*)(b + i));
+		auto differ = (uint64_t)_mm512_cmpneq_epi8_mask(x, y);
+		if (differ != 0) {
+			return i + lowest_bit64(differ);
+		}
+	}
+	return i + forward_avx2(a + i, b + i, max - i);
+}
+
+LCE_TARGET("avx512f,avx512bw")
+static size_t mirror_avx512(const char* a, const char* b, size_t max)
+{
+	const auto reverse = _mm512_set_epi64(
+		0x0001020304050607LL, 0x08090A0B0C0D0E0FLL, 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL,
+		0x0001020304050607LL, 0x08090A0B0C0D0E0FLL, 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL);
+	size_t i = 0;
+	for (; i + 64 <= max; i += 64) {
+		auto x = _mm512_loadu_si512((const void*)(a + i));
+		auto y = _mm512_loadu_si512((const void*)(b - i - 63));
+		y = _mm512_shuffle_i64x2(_mm512_shuffle_epi8(y, reverse), _mm512_shuffle_epi8(y, reverse), 0x1B); // and the lanes
+		auto differ = (uint64_t)_mm512_cmpneq_epi8_mask(x, y);
+		if (differ != 0) {
+			return i + lowest_bit64(differ);
+		}
+	}
+	return i + mirror_avx2(a + i, b - i, max - i);
+}
+
+#ifdef _MSC_VER
+static bool has_avx2()
+{
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] < 7) {
+		return false;
+	}
+	__cpuid(r, 1);
+	bool avx = (r[2] & (1 << 27)) != 0 && (r[2] & (1 << 28)) != 0; // OSXSAVE, AVX
+	if (!avx || (_xgetbv(0) & 0x6) != 0x6) { // the system saves the XMM and YMM registers
+		return false;
+	}
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 5)) != 0;
+}
+
+static bool has_avx512()
+{
+	if (!has_avx2() || (_xgetbv(0) & 0xE0) != 0xE0) { // and the opmask and ZMM registers
+		return false;
+	}
+	int r[4];
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 16)) != 0 && (r[1] & (1 << 30)) != 0; // AVX-512F, AVX-512BW
+}
+#else
+static bool has_avx2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static bool has_avx512()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+#endif
+
+#endif // LCE_X86
+
+struct LceKernels
+{
+	string isa;
+	size_t(*forward)(const char*, const char*, size_t);
+	size_t(*mirror)(const char*, const char*, size_t);
+};
+
+// The kernels of the named instruction set, or false if the processor does not have it.
+static bool find_kernels(string isa, LceKernels& kernels)
+{
+#ifdef LCE_X86
+	if (isa == "auto") {
+		return find_kernels("avx512", kernels) || find_kernels("avx2", kernels) || find_kernels("sse2", kernels);
+	}
+	if (isa == "avx512" && has_avx512()) {
+		kernels = { isa, forward_avx512, mirror_avx512 };
+		return true;
+	}
+	if (isa == "avx2" && has_avx2()) {
+		kernels = { isa, forward_avx2, mirror_avx2 };
+		return true;
+	}
+	if (isa == "sse2") { // every x86-64 processor
+		kernels = { isa, forward_sse2, mirror_sse2 };
+		return true;
+	}
+#endif
+	if (isa == "scalar" || isa == "auto") {
+		kernels = { "scalar", forward_scalar, mirror_scalar };
+		return true;
+	}
+	return false;
+}
+
+static LceKernels& kernels()
+{
+	static LceKernels chosen = [] {
+		LceKernels k;
+		find_kernels("auto", k);
+		return k;
+	}();
+	return chosen;
+}
+
+size_t lce_forward(const char* a, const char* b, size_t max)
+{
+	return kernels().forward(a, b, max);
+}
+
+size_t lce_mirror(const char* a, const char* b, size_t max)
+{
+	return kernels().mirror(a, b, max);
+}
+
+size_t lce_mirror(const char* a, const char* b, size_t max, const char* table)
+{
+	size_t i = 0;
+	while (i < max && a[i] == table[(unsigned char)*(b - i)]) {
+		++i;
+	}
+	return i;
+}
+
+string lce_isa()
+{
+	return kernels().isa;
+}
+
+bool lce_select(string isa)
+{
+	LceKernels k;
+	if (!find_kernels(isa, k)) {
+		return false;
+	}
+	kernels() = k;
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+/*
+* Longest common extension: how many bytes in a row are the same in two places.
+* The plain comparisons take 16, 32 or 64 bytes a step (SSE2, AVX2, AVX-512),
+* whichever the processor has, as found at run time; a scalar loop otherwise.
+* The comparisons through a table, e.g. the complement, stay scalar.
+*/
+
+// Number of i < max in a row with a[i] == b[i].
+size_t lce_forward(const char* a, const char* b, size_t max);
+
+// Number of i < max in a row with a[i] == b[-i]: a goes forward, b goes backward from b[0].
+size_t lce_mirror(const char* a, const char* b, size_t max);
+
+// The same, with b's bytes taken through table first.
+size_t lce_mirror(const char* a, const char* b, size_t max, const char* table);
+
+// The instruction set in use: "avx512", "avx2", "sse2" or "scalar".
+string lce_isa();
+
+// Use the given instruction set, or the best one if "auto";
+// false if the processor does not have it (the choice is then unchanged).
+bool lce_select(string isa);
@@ -0,0 +1,89 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+#include "Error.h"
+
+using namespace std;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+void MappedFile::Open(string filename)
+{
+	Close();
+
+#ifdef _WIN32
+	file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		Error().Fatal("Cannot open for reading file: " + filename);
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file_handle, &file_size);
+	size = (size_t)file_size.QuadPart;
+	if (size == 0) {
+		return;
+	}
+	mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_handle == NULL) {
+		mapping_handle = nullptr;
+		Error().Fatal("Cannot map file: " + filename);
+	}
+	data = (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+#else
+	file_descriptor = open(filename.c_str(), O_RDONLY);
+	if (file_descriptor < 0) {
+		Error().Fatal("Cannot open for reading file: " + filename);
+	}
+	struct stat file_status;
+	fstat(file_descriptor, &file_status);
+	size = (size_t)file_status.st_size;
+	if (size == 0) {
+		return;
+	}
+	auto mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+	data = mapped == MAP_FAILED ? nullptr : (const char*)mapped;
+#endif
+	if (data == nullptr) {
+		Error().Fatal("Cannot map file: " + filename);
+	}
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping_handle != nullptr) {
+		CloseHandle(mapping_handle);
+	}
+	if (file_handle != nullptr) {
+		CloseHandle(file_handle);
+	}
+	mapping_handle = nullptr;
+	file_handle = nullptr;
+#else
+	if (data != nullptr) {
+		munmap((void*)data, size);
+	}
+	if (file_descriptor >= 0) {
+		close(file_descriptor);
+	}
+	file_descriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
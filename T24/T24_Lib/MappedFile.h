@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+/*
+* Read-only view of a file, memory mapped, e.g. a .t24r or a .t24p file.
+*/
+class MappedFile
+{
+public:
+	MappedFile() {}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	// Fatal if the file cannot be mapped.
+	void Open(string filename);
+	void Close();
+
+	const char* Data() const {
+		return data;
+	}
+	size_t Size() const {
+		return size;
+	}
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#else
+	int file_descriptor = -1;
+#endif
+};
@@ -0,0 +1,65 @@
+#include <algorithm>
+
+#include "NBlockIndex.h"
+#include "PackedSequence.h"
+
+using namespace std;
+
+NBlockIndex::NBlockIndex(string_view sequence, const Config& config)
+	: size((streamsize)sequence.size())
+{
+	bool meaningful[256];
+	for (int c = 0; c < 256; ++c) {
+		meaningful[c] = !config.is_N_letter((char)c);
+	}
+
+	valid.assign((size_t)size / 64 + 1, 0);
+	for (streamsize i = 0; i < size; ) {
+		if (!meaningful[(unsigned char)sequence[(size_t)i]]) {
+			++i;
+			continue;
+		}
+		auto start = i;
+		while (i < size && meaningful[(unsigned char)sequence[(size_t)i]]) {
+			valid[(size_t)i / 64] |= (uint64_t)1 << (i % 64);
+			++i;
+		}
+		runs.push_back({ start, i });
+	}
+}
+
+streamsize NBlockIndex::ValidFrom(streamsize i, streamsize max_length) const
+{
+	max_length = min(max_length, size - min(i, size));
+	streamsize run = 0;
+	while (run < max_length) {
+		auto word = (size_t)(i + run) / 64;
+		auto shift = (i + run) % 64;
+		auto invalid = ~(valid[word] >> shift);
+		if (shift != 0) {
+			invalid &= ~(uint64_t)0 >> shift;
+		}
+		if (invalid != 0) {
+			run += lowest_bit64(invalid);
+			break;
+		}
+		run += 64 - shift;
+	}
+	return min(run, max_length);
+}
+
+streamsize NBlockIndex::CountFrom(streamsize from) const
+{
+	streamsize count = 0;
+	for (auto r = RunAfter(from); r < runs.size(); ++r) {
+		count += runs[r].end - max(runs[r].start, from);
+	}
+	return count;
+}
+
+size_t NBlockIndex::RunAfter(streamsize i) const
+{
+	auto found = upper_bound(runs.begin(), runs.end(), i,
+		[](streamsize i, const Run& run) { return i < run.end; });
+	return (size_t)(found - runs.begin());
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <ios>
+#include <cstdint>
+
+#include "Config.h"
+
+using namespace std;
+
+/*
+* Where the meaningful letters of a sequence are (config.letters, see Config::is_N_letter):
+* the runs of them between the N letters, sorted, and one bit per letter.
+* Built in one pass over the sequence, so that the phases go from run to run
+* and skip the gaps of an assembly whole, and test a letter with one bit rather than a set lookup.
+*/
+class NBlockIndex
+{
+public:
+	// Meaningful letters [start, end).
+	struct Run
+	{
+		streamsize start;
+		streamsize end;
+	};
+
+	NBlockIndex() = default;
+	NBlockIndex(string_view sequence, const Config& config);
+
+	const vector<Run>& Runs() const {
+		return runs;
+	}
+
+	bool IsValid(streamsize i) const {
+		return i >= 0 && i < size && ((valid[(size_t)i / 64] >> (i % 64)) & 1) != 0;
+	}
+
+	// Meaningful letters in a row from i on, at most max_length.
+	streamsize ValidFrom(streamsize i, streamsize max_length) const;
+
+	// Meaningful letters at positions from on.
+	streamsize CountFrom(streamsize from) const;
+
+	// The first run that ends after i, runs.size() if none.
+	size_t RunAfter(streamsize i) const;
+
+private:
+	streamsize size = 0;
+	vector<Run> runs;
+	vector<uint64_t> valid; // bit i for letter i
+};
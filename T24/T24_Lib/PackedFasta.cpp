@@ -0,0 +1,348 @@
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <regex>
+#include <cstring>
+#include <cstddef>
+#include <cctype>
+
+#include "PackedFasta.h"
+#include "Crc32.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+static const char packed_magic[4] = { 'T', '2', '4', 'P' };
+static const uint32_t packed_version = 1;
+
+// The size and last write time of a file; false if there is no such file.
+static bool source_stamp(string source, uint64_t& size, int64_t& time)
+{
+	error_code ec;
+	size = (uint64_t)fs::file_size(source, ec);
+	if (ec) {
+		return false;
+	}
+	time = (int64_t)fs::last_write_time(source, ec).time_since_epoch().count();
+	return !ec;
+}
+
+static void put_varint(vector<uint8_t>& bytes, uint64_t value)
+{
+	while (value >= 0x80) {
+		bytes.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((uint8_t)value);
+}
+
+// False past the end.
+static bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; p < end && shift < 64; shift += 7) {
+		auto b = *p++;
+		value |= (uint64_t)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+* Writer.
+*/
+
+bool write_packed_fasta(string filename, string source_filename, string fasta_header, string sequence_name,
+	int64_t absolute_origin, string_view sequence, string alphabet)
+{
+	unsigned char letter2code[256];
+	fill(begin(letter2code), end(letter2code), 0xFF);
+	for (size_t c = 0; c < alphabet.size(); ++c) {
+		letter2code[(unsigned char)toupper(alphabet[c])] = (unsigned char)c;
+		letter2code[(unsigned char)tolower(alphabet[c])] = (unsigned char)c;
+	}
+	uint32_t bits = 1;
+	while ((1u << bits) < alphabet.size()) {
+		++bits;
+	}
+
+	auto size = sequence.size();
+	auto words = size / 64 + 1;
+	vector<uint64_t> planes(bits * words, 0);
+	vector<uint64_t> valid(words, 0);
+	for (size_t word = 0; word < words; ++word) {
+		uint64_t valid_word = 0;
+		uint64_t plane_words[8] = {};
+		for (size_t i = word * 64; i < min(size, word * 64 + 64); ++i) {
+			auto code = letter2code[(unsigned char)sequence[i]];
+			if (code == 0xFF) {
+				continue;
+			}
+			valid_word |= (uint64_t)1 << (i % 64);
+			for (uint32_t b = 0; b < bits; ++b) {
+				plane_words[b] |= (uint64_t)((code >> b) & 1) << (i % 64);
+			}
+		}
+		valid[word] = valid_word;
+		for (uint32_t b = 0; b < bits; ++b) {
+			planes[b * words + word] = plane_words[b];
+		}
+	}
+
+	// Runs of the same letter outside the alphabet, then runs of lower case letters.
+	vector<uint8_t> other_runs, lower_runs;
+	uint64_t other_count = 0, lower_count = 0;
+	size_t other_end = 0, lower_end = 0; // of the previous run
+	for (size_t i = 0; i < size; ) {
+		auto letter = (unsigned char)sequence[i];
+		if (letter2code[letter] != 0xFF) {
+			++i;
+			continue;
+		}
+		auto start = i;
+		while (i < size && (unsigned char)sequence[i] == letter) {
+			++i;
+		}
+		put_varint(other_runs, start - other_end);
+		put_varint(other_runs, i - start);
+		other_runs.push_back(letter);
+		other_end = i;
+		++other_count;
+	}
+	for (size_t i = 0; i < size; ) {
+		if (!islower((unsigned char)sequence[i])) {
+			++i;
+			continue;
+		}
+		auto start = i;
+		while (i < size && islower((unsigned char)sequence[i])) {
+			++i;
+		}
+		put_varint(lower_runs, start - lower_end);
+		put_varint(lower_runs, i - start);
+		lower_end = i;
+		++lower_count;
+	}
+
+	// Mostly letters outside the alphabet, e.g. no letters given in the config: not worth a file.
+	if (other_runs.size() + lower_runs.size() > size / 2) {
+		Error().Warn("Not packed, mostly letters other than " + alphabet + ": " + source_filename);
+		return false;
+	}
+
+	string names = source_filename + '\0' + sequence_name + '\0' + fasta_header + '\0';
+
+	PackedHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, packed_magic, sizeof(header.magic));
+	header.version = packed_version;
+	header.sequence_size = size;
+	header.absolute_origin = absolute_origin;
+	source_stamp(source_filename, header.source_size, header.source_time);
+	header.bits = bits;
+	header.alphabet_size = (uint32_t)alphabet.size();
+	header.words = words;
+	header.other_count = other_count;
+	header.lower_count = lower_count;
+
+	// Written aside first, so that a run that stops halfway leaves no broken file behind.
+	auto temporary_filename = filename + ".tmp";
+	ofstream os(temporary_filename, ios::binary | ios::trunc);
+	if (!os) {
+		Error().Warn("Cannot open for writing file: " + temporary_filename);
+		return false;
+	}
+	os.write((const char*)&header, sizeof(header));
+
+	auto write_section = [&](PackedSection section, const void* data, size_t size) {
+		static const char padding[8] = {};
+		auto offset = (uint64_t)os.tellp();
+		if (offset % 8 != 0) {
+			os.write(padding, 8 - offset % 8);
+			offset += 8 - offset % 8;
+		}
+		auto& entry = header.sections[(size_t)section];
+		entry.offset = offset;
+		entry.size = size;
+		entry.checksum = crc32(data, size);
+		os.write((const char*)data, size);
+	};
+	write_section(PackedSection::names, names.data(), names.size());
+	write_section(PackedSection::alphabet, alphabet.data(), alphabet.size());
+	write_section(PackedSection::planes, planes.data(), planes.size() * sizeof(uint64_t));
+	write_section(PackedSection::valid, valid.data(), valid.size() * sizeof(uint64_t));
+	write_section(PackedSection::other_runs, other_runs.data(), other_runs.size());
+	write_section(PackedSection::lower_runs, lower_runs.data(), lower_runs.size());
+
+	header.header_checksum = crc32(&header, offsetof(PackedHeader, header_checksum));
+	os.seekp(0);
+	os.write((const char*)&header, sizeof(header));
+	os.close();
+	error_code ec;
+	if (os) {
+		fs::rename(temporary_filename, filename, ec);
+	}
+	if (!os || ec) {
+		fs::remove(temporary_filename, ec);
+		Error().Warn("Cannot write file: " + filename);
+		return false;
+	}
+	return true;
+} // write_packed_fasta()
+
+string packed_file_name(string source_filename)
+{
+	return source_filename + ".t24p";
+}
+
+bool is_packed_file_name(string filename)
+{
+	static const regex regex_t24p(".+\\.t24p", regex::icase);
+	return regex_match(filename, regex_t24p);
+}
+
+/*
+* Reader.
+*/
+
+void PackedFasta::Open(string filename)
+{
+	this->filename = filename;
+	mapped.Open(filename);
+	header = (const PackedHeader*)mapped.Data();
+
+	if (mapped.Size() < sizeof(PackedHeader) || memcmp(header->magic, packed_magic, sizeof(packed_magic)) != 0) {
+		Error().Fatal("Not a packed sequence file: " + filename);
+	}
+	if (header->version != packed_version) {
+		Error().Fatal("Unsupported packed sequence file version " + to_string(header->version) + ": " + filename);
+	}
+	if (header->header_checksum != crc32(header, offsetof(PackedHeader, header_checksum))) {
+		Error().Fatal("Header checksum mismatch: " + filename);
+	}
+	if (header->bits == 0 || header->bits > 8 || header->words != header->sequence_size / 64 + 1) {
+		Error().Fatal("Wrong sizes in the header: " + filename);
+	}
+
+	// Expected section sizes; the names and the runs vary.
+	uint64_t expected[(size_t)PackedSection::total] = {};
+	expected[(size_t)PackedSection::alphabet] = header->alphabet_size;
+	expected[(size_t)PackedSection::planes] = header->bits * header->words * sizeof(uint64_t);
+	expected[(size_t)PackedSection::valid] = header->words * sizeof(uint64_t);
+
+	for (size_t s = 0; s < (size_t)PackedSection::total; ++s) {
+		auto& entry = header->sections[s];
+		if (entry.offset % 8 != 0 || entry.offset > mapped.Size() || entry.size > mapped.Size() - entry.offset) {
+			Error().Fatal("Section " + to_string(s) + " out of bounds: " + filename);
+		}
+		if (expected[s] != 0 && entry.size != expected[s]) {
+			Error().Fatal("Section " + to_string(s) + " has a wrong size: " + filename);
+		}
+		if (entry.checksum != crc32(mapped.Data() + entry.offset, (size_t)entry.size)) {
+			Error().Fatal("Section " + to_string(s) + " checksum mismatch: " + filename);
+		}
+	}
+
+	auto& names = header->sections[(size_t)PackedSection::names];
+	if (count(mapped.Data() + names.offset, mapped.Data() + names.offset + names.size, '\0') != 3) {
+		Error().Fatal("Wrong names section: " + filename);
+	}
+}
+
+string PackedFasta::SourceFilename() const
+{
+	return string(Column<char>(PackedSection::names));
+}
+
+string PackedFasta::SequenceName() const
+{
+	auto names = Column<char>(PackedSection::names);
+	return string(names + strlen(names) + 1);
+}
+
+string PackedFasta::FastaHeader() const
+{
+	auto names = Column<char>(PackedSection::names);
+	names += strlen(names) + 1;
+	return string(names + strlen(names) + 1);
+}
+
+bool PackedFasta::PackedFrom(string source) const
+{
+	uint64_t size;
+	int64_t time;
+	return source_stamp(source, size, time) && size == header->source_size && time == header->source_time;
+}
+
+void PackedFasta::Unpack(string& sequence) const
+{
+	// Bit k of a byte to bit 0 of byte k, for eight letters at a time.
+	static const auto spread = [] {
+		vector<uint64_t> spread(256, 0);
+		for (unsigned v = 0; v < 256; ++v) {
+			for (int k = 0; k < 8; ++k) {
+				spread[v] |= (uint64_t)((v >> k) & 1) << (8 * k);
+			}
+		}
+		return spread;
+	}();
+
+	char code2letter[256];
+	fill(begin(code2letter), end(code2letter), 'N');
+	auto alphabet = Alphabet();
+	copy(alphabet.begin(), alphabet.end(), code2letter);
+
+	// The letters of the alphabet, upper case; the other places get whatever code 0 is.
+	auto size = Size();
+	auto bits = Bits();
+	sequence.resize(size);
+	for (size_t i = 0; i < size; i += 8) {
+		auto word = i / 64;
+		auto shift = i % 64;
+		uint64_t codes = 0;
+		for (int b = 0; b < bits; ++b) {
+			codes |= spread[(Plane(b)[word] >> shift) & 0xFF] << b;
+		}
+		auto n = min((size_t)8, size - i);
+		for (size_t k = 0; k < n; ++k) {
+			sequence[i + k] = code2letter[(codes >> (8 * k)) & 0xFF];
+		}
+	}
+
+	// The other letters, then the lower case.
+	auto wrong_runs = [&]() {
+		Error().Fatal("Wrong runs in the packed sequence file: " + filename);
+	};
+	auto& other = header->sections[(size_t)PackedSection::other_runs];
+	auto runs = Column<uint8_t>(PackedSection::other_runs);
+	auto runs_end = runs + other.size;
+	size_t run_end = 0;
+	for (uint64_t r = 0; r < header->other_count; ++r) {
+		uint64_t gap, length;
+		if (!get_varint(runs, runs_end, gap) || !get_varint(runs, runs_end, length) || runs == runs_end
+			|| gap > size - run_end || length > size - run_end - gap) {
+			wrong_runs();
+		}
+		auto start = run_end + (size_t)gap;
+		fill_n(sequence.begin() + start, (size_t)length, (char)*runs++);
+		run_end = start + (size_t)length;
+	}
+	auto& lower = header->sections[(size_t)PackedSection::lower_runs];
+	runs = Column<uint8_t>(PackedSection::lower_runs);
+	runs_end = runs + lower.size;
+	run_end = 0;
+	for (uint64_t r = 0; r < header->lower_count; ++r) {
+		uint64_t gap, length;
+		if (!get_varint(runs, runs_end, gap) || !get_varint(runs, runs_end, length)
+			|| gap > size - run_end || length > size - run_end - gap) {
+			wrong_runs();
+		}
+		auto first = sequence.begin() + run_end + (size_t)gap;
+		transform(first, first + (size_t)length, first, [](char c) { return (char)tolower((unsigned char)c); });
+		run_end = run_end + (size_t)gap + (size_t)length;
+	}
+} // Unpack()
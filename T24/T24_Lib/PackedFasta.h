@@ -0,0 +1,125 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "MappedFile.h"
+
+using namespace std;
+
+/*
+* Packed sequence file (.t24p): an input FASTA file as loaded, for reloading it without parsing
+* and for mapping its letters straight into PackedSequence. Like UCSC .2bit, for any alphabet.
+* All numbers are little endian, every section starts at a multiple of 8 bytes.
+*
+*	header			PackedHeader, with the section table
+*	names			source filename '\0' sequence name '\0' FASTA header lines '\0'
+*	alphabet		the letters, upper case, in the order of their codes
+*	planes			bits planes of words: bit b of the code of letter i is bit i of plane b
+*	valid			one plane: bit i is set when letter i is in the alphabet, in either case
+*	other_runs		runs of a letter not in the alphabet, e.g. N: the gap since the end of the previous run
+*					and the length (varints, 7 bits a byte, low bits first), then the letter (byte)
+*	lower_runs		runs of lower case letters: the gap and the length (varints)
+*
+* So the letters of the alphabet take bits + 1 bits each, e.g. 3 for acgt,
+* and the control characters of the FASTA file are not kept.
+* Every section has a CRC-32 in the section table; the header has its own one.
+*/
+enum class PackedSection : uint32_t {
+	names,
+	alphabet,
+	planes,
+	valid,
+	other_runs,
+	lower_runs,
+	total // not a section
+};
+
+struct PackedSectionEntry
+{
+	uint64_t offset; // from the beginning of the file
+	uint64_t size; // in bytes
+	uint32_t checksum;
+	uint32_t reserved;
+};
+
+struct PackedHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sequence_size;
+	int64_t absolute_origin;
+	uint64_t source_size; // of the FASTA file, to tell when it has changed
+	int64_t source_time; // its last write time
+	uint32_t bits; // planes
+	uint32_t alphabet_size;
+	uint64_t words; // per plane, sequence_size / 64 + 1
+	uint64_t other_count; // runs
+	uint64_t lower_count; // runs
+	PackedSectionEntry sections[(size_t)PackedSection::total];
+	uint32_t header_checksum; // of all the bytes above
+	uint32_t reserved_end;
+};
+
+/*
+* Read-only view of a .t24p file, memory mapped.
+*/
+class PackedFasta
+{
+public:
+	// Map the file and check the header and all the checksums; fatal on any mismatch.
+	void Open(string filename);
+
+	const PackedHeader& Header() const {
+		return *header;
+	}
+
+	string SourceFilename() const;
+	string SequenceName() const;
+	string FastaHeader() const;
+	string Alphabet() const {
+		return string(mapped.Data() + header->sections[(size_t)PackedSection::alphabet].offset, header->alphabet_size);
+	}
+
+	size_t Size() const {
+		return (size_t)header->sequence_size;
+	}
+	int Bits() const {
+		return (int)header->bits;
+	}
+	size_t Words() const {
+		return (size_t)header->words;
+	}
+	const uint64_t* Plane(int b) const {
+		return Column<uint64_t>(PackedSection::planes) + b * Words();
+	}
+	const uint64_t* Valid() const {
+		return Column<uint64_t>(PackedSection::valid);
+	}
+
+	// The letters as they were in the FASTA file, without the control characters.
+	void Unpack(string& sequence) const;
+
+	// True if the file was packed from source as it is now.
+	bool PackedFrom(string source) const;
+
+private:
+	string filename;
+	MappedFile mapped;
+	const PackedHeader* header = nullptr;
+
+	template <class T>
+	const T* Column(PackedSection section) const {
+		return (const T*)(mapped.Data() + header->sections[(size_t)section].offset);
+	}
+};
+
+// The letters of a FASTA file into a .t24p file, with the letters of alphabet packed (upper case, sorted);
+// false, with a warning, if it cannot be written.
+bool write_packed_fasta(string filename, string source_filename, string fasta_header, string sequence_name,
+	int64_t absolute_origin, string_view sequence, string alphabet);
+
+// Where the packed file of a FASTA file is kept: next to it, chr1.fa -> chr1.fa.t24p.
+string packed_file_name(string source_filename);
+
+bool is_packed_file_name(string filename);
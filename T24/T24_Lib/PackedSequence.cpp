@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cctype>
+
+#include "PackedSequence.h"
+#include "PackedFasta.h"
+
+using namespace std;
+
+string PackedSequence::Alphabet(const unordered_set<char>& letters)
+{
+	// Codes in the alphabetical order of the letters.
+	string alphabet;
+	for (auto letter : letters) {
+		alphabet.push_back((char)toupper(letter));
+	}
+	sort(alphabet.begin(), alphabet.end());
+	alphabet.erase(unique(alphabet.begin(), alphabet.end()), alphabet.end());
+	return alphabet;
+}
+
+PackedSequence::PackedSequence(string_view sequence, const unordered_set<char>& letters)
+	: size(sequence.size())
+{
+	auto alphabet = Alphabet(letters);
+	unsigned char letter2code[256];
+	fill(begin(letter2code), end(letter2code), 0xFF);
+	for (size_t c = 0; c < alphabet.size(); ++c) {
+		letter2code[(unsigned char)toupper(alphabet[c])] = (unsigned char)c;
+		letter2code[(unsigned char)tolower(alphabet[c])] = (unsigned char)c;
+	}
+	while ((1u << bits) < alphabet.size()) {
+		++bits;
+	}
+
+	words = size / 64 + 1;
+	own_valid.assign(words, 0);
+	own_planes.assign(bits * words, 0);
+	for (size_t i = 0; i < size; ++i) {
+		auto code = letter2code[(unsigned char)sequence[i]];
+		if (code == 0xFF) {
+			continue;
+		}
+		uint64_t bit = (uint64_t)1 << (i % 64);
+		own_valid[i / 64] |= bit;
+		for (int b = 0; b < bits; ++b) {
+			if ((code >> b) & 1) {
+				own_planes[b * words + i / 64] |= bit;
+			}
+		}
+	}
+	planes = own_planes.data();
+	valid = own_valid.data();
+}
+
+PackedSequence::PackedSequence(const PackedFasta& packed)
+	: size(packed.Size()), bits(packed.Bits()), words(packed.Words()),
+	planes(packed.Plane(0)), valid(packed.Valid())
+{
+}
+
+unsigned PackedSequence::Code(size_t i) const
+{
+	unsigned code = 0;
+	for (int b = 0; b < bits; ++b) {
+		code |= (unsigned)((planes[b * words + i / 64] >> (i % 64)) & 1) << b;
+	}
+	return code;
+}
+
+size_t PackedSequence::ValidRun(size_t i, size_t limit) const
+{
+	size_t run = 0;
+	while (i + run < size && run < limit) {
+		auto invalid = ~Extract(valid, i + run);
+		if (invalid != 0) {
+			run += lowest_bit64(invalid);
+			break;
+		}
+		run += 64;
+	}
+	return min(min(run, limit), size - min(i, size));
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+class PackedFasta;
+
+inline int popcount64(uint64_t x) {
+#ifdef _MSC_VER
+	return (int)__popcnt64(x);
+#else
+	return __builtin_popcountll(x);
+#endif
+}
+
+// Index of the lowest set bit; x must not be zero.
+inline int lowest_bit64(uint64_t x) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+/*
+* A sequence packed into bit planes: letter i gets a code from 0 to (number of letters - 1),
+* and bit b of that code is bit i of plane b.
+* Letters are the meaningful ones from config (case insensitive), everything else is invalid.
+* Comparing 64 letters at a time then takes one XOR per plane.
+* The planes are either packed here or mapped from a .t24p file packed with the same letters.
+*/
+class PackedSequence
+{
+public:
+	PackedSequence(string_view sequence, const unordered_set<char>& letters);
+	PackedSequence(const PackedFasta& packed); // the file must outlive this
+
+	PackedSequence(const PackedSequence&) = delete;
+	PackedSequence& operator=(const PackedSequence&) = delete;
+	PackedSequence(PackedSequence&&) = default;
+	PackedSequence& operator=(PackedSequence&&) = default;
+
+	// The letters, upper case, in the order of their codes.
+	static string Alphabet(const unordered_set<char>& letters);
+
+	size_t Size() const {
+		return size;
+	}
+	int Bits() const {
+		return bits;
+	}
+
+	bool IsValid(size_t i) const {
+		return i < size && ((valid[i / 64] >> (i % 64)) & 1) != 0;
+	}
+	unsigned Code(size_t i) const;
+
+	// Bit k is set when letters i + k and j + k differ,
+	// or one of them is invalid or past the end.
+	uint64_t Mismatches(size_t i, size_t j) const {
+		uint64_t differ = ~(Extract(valid, i) & Extract(valid, j));
+		for (int b = 0; b < bits; ++b) {
+			auto plane = planes + b * words;
+			differ |= Extract(plane, i) ^ Extract(plane, j);
+		}
+		return differ;
+	}
+
+	// Number of valid letters in a row starting at i, counted up to limit.
+	size_t ValidRun(size_t i, size_t limit = SIZE_MAX) const;
+
+private:
+	size_t size;
+	int bits = 1;
+	size_t words; // per plane
+	const uint64_t* planes; // bits planes one after another
+	const uint64_t* valid;
+
+	// Unless mapped.
+	vector<uint64_t> own_planes;
+	vector<uint64_t> own_valid;
+
+	// 64 bits of the plane starting at bit i, zeros past the end.
+	uint64_t Extract(const uint64_t* plane, size_t i) const {
+		auto word = i / 64;
+		auto shift = i % 64;
+		if (word >= words) {
+			return 0;
+		}
+		uint64_t low = plane[word] >> shift;
+		if (shift == 0 || word + 1 >= words) {
+			return low;
+		}
+		return low | (plane[word + 1] << (64 - shift));
+	}
+};
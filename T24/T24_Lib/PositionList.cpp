@@ -0,0 +1,99 @@
+#include <algorithm>
+
+#include "PositionList.h"
+
+using namespace std;
+
+void PositionList::const_iterator::Decode()
+{
+	if (index >= list->count) {
+		return;
+	}
+	if (!list->IsPacked()) {
+		value = list->small[index];
+		return;
+	}
+	uint64_t difference = 0;
+	for (int shift = 0; ; shift += 7) {
+		auto b = list->packed[byte++];
+		difference |= (uint64_t)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			break;
+		}
+	}
+	value += difference;
+}
+
+void PositionList::Add(streamsize position)
+{
+	auto p = (uint64_t)position;
+
+	if (!IsPacked() && count < small_max && p <= UINT32_MAX) {
+		// Insert in place, keeping the order.
+		auto i = count;
+		while (i > 0 && small[i - 1] > p) {
+			small[i] = small[i - 1];
+			--i;
+		}
+		small[i] = (uint32_t)p;
+		++count;
+		return;
+	}
+
+	if (!IsPacked() || p < Last()) {
+		// Switch to packed, or insert out of order.
+		vector<uint64_t> positions(begin(), end());
+		positions.insert(upper_bound(positions.begin(), positions.end(), p), p);
+		Repack(positions);
+		return;
+	}
+
+	Pack(p - Last());
+	SetLast(p);
+	++count;
+}
+
+void PositionList::Merge(const PositionList& other)
+{
+	if (other.Empty()) {
+		return;
+	}
+	if (Empty() || (uint64_t)other.Front() >= (IsPacked() ? Last() : small[count - 1])) {
+		// After all of these: added in order.
+		for (auto p : other) {
+			Add(p);
+		}
+		return;
+	}
+	vector<uint64_t> positions;
+	positions.reserve(count + other.count);
+	merge(begin(), end(), other.begin(), other.end(), back_inserter(positions));
+	Repack(positions);
+}
+
+void PositionList::Clear()
+{
+	packed.clear();
+	count = 0;
+}
+
+void PositionList::Pack(uint64_t value)
+{
+	while (value >= 0x80) {
+		packed.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	packed.push_back((uint8_t)value);
+}
+
+void PositionList::Repack(const vector<uint64_t>& positions)
+{
+	packed.clear();
+	uint64_t last = 0;
+	for (auto p : positions) {
+		Pack(p - last);
+		last = p;
+	}
+	SetLast(last);
+	count = (uint32_t)positions.size();
+}
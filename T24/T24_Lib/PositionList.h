@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <ios>
+
+using namespace std;
+
+/*
+* The positions of a repeat family, kept sorted and compact.
+* Up to small_max positions that fit in 32 bits are kept in place, as 32-bit offsets,
+* which is what most first phase sequences need.
+* Past that, or with a position that does not fit, the list becomes a stream of varint encoded
+* differences between consecutive positions: copies of a satellite are close to each other
+* and take a byte or two apiece.
+* Positions are best added in increasing order, anything else costs a re-encoding.
+*/
+class PositionList
+{
+public:
+	static const size_t small_max = 2;
+
+	class const_iterator
+	{
+	public:
+		using iterator_category = forward_iterator_tag;
+		using value_type = streamsize;
+		using difference_type = ptrdiff_t;
+		using pointer = const streamsize*;
+		using reference = streamsize;
+
+		const_iterator(const PositionList* list, size_t index)
+			: list(list), index(index)
+		{
+			Decode();
+		}
+
+		streamsize operator*() const {
+			return (streamsize)value;
+		}
+		const_iterator& operator++() {
+			++index;
+			Decode();
+			return *this;
+		}
+		bool operator==(const const_iterator& other) const {
+			return index == other.index;
+		}
+		bool operator!=(const const_iterator& other) const {
+			return index != other.index;
+		}
+
+	private:
+		const PositionList* list;
+		size_t index; // of the current position
+		size_t byte = 0; // of the next difference in packed
+		uint64_t value = 0;
+
+		void Decode();
+	};
+
+	void Add(streamsize position);
+	// Adds all the positions of other, in one re-encoding.
+	void Merge(const PositionList& other);
+	void Clear();
+
+	size_t Size() const {
+		return count;
+	}
+	bool Empty() const {
+		return count == 0;
+	}
+	streamsize Front() const {
+		return *begin();
+	}
+
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+	const_iterator end() const {
+		return const_iterator(this, count);
+	}
+
+	// Memory taken by the positions themselves, in bytes.
+	size_t Bytes() const {
+		return sizeof(PositionList) + packed.capacity();
+	}
+
+private:
+	vector<uint8_t> packed; // differences, varint encoded, once the list is not small
+	uint32_t count = 0;
+	uint32_t small[small_max] = {}; // sorted, while the list is small; then the largest position
+
+	bool IsPacked() const {
+		return !packed.empty();
+	}
+	uint64_t Last() const {
+		return small[0] | (uint64_t)small[1] << 32;
+	}
+	void SetLast(uint64_t value) {
+		small[0] = (uint32_t)value;
+		small[1] = (uint32_t)(value >> 32);
+	}
+	void Pack(uint64_t value);
+	void Repack(const vector<uint64_t>& positions);
+};
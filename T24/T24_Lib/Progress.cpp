@@ -0,0 +1,108 @@
+#include <chrono>
+#include <csignal>
+#include <cmath>
+
+#include "Progress.h"
+
+using namespace std;
+
+static atomic<bool> interrupted{ false };
+
+extern "C" void on_interrupt(int signal_number)
+{
+	interrupted.store(true, memory_order_relaxed);
+	signal(signal_number, SIG_DFL);
+}
+
+void cancel_on_interrupt()
+{
+	signal(SIGINT, on_interrupt);
+	signal(SIGTERM, on_interrupt);
+}
+
+static int64_t now_nanoseconds()
+{
+	return (int64_t)chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Progress::Start(Phase phase, uint64_t total)
+{
+	this->done.store(0, memory_order_relaxed);
+	this->total.store(total, memory_order_relaxed);
+	this->waiting.store(0, memory_order_relaxed);
+	this->started.store(now_nanoseconds(), memory_order_relaxed);
+	this->phase.store((int)phase, memory_order_relaxed);
+}
+
+bool Progress::IsCancelled() const
+{
+	return cancelled.load(memory_order_relaxed) || interrupted.load(memory_order_relaxed);
+}
+
+Progress::Snapshot Progress::Read() const
+{
+	Snapshot snapshot;
+	snapshot.phase = (Phase)phase.load(memory_order_relaxed);
+	snapshot.done = done.load(memory_order_relaxed);
+	snapshot.total = total.load(memory_order_relaxed);
+	snapshot.waiting = waiting.load(memory_order_relaxed);
+	snapshot.seconds = (now_nanoseconds() - started.load(memory_order_relaxed)) / 1e9;
+	return snapshot;
+}
+
+ProgressReporter::ProgressReporter(const Progress& progress, int interval_seconds, string title, ostream& out)
+	: progress(progress), interval_seconds(interval_seconds), title(title), out(out)
+{
+	if (interval_seconds > 0) {
+		reporter = thread([this]() { Report(); });
+	}
+}
+
+ProgressReporter::~ProgressReporter()
+{
+	{
+		lock_guard<mutex> lock(stop_mutex);
+		stopping = true;
+	}
+	stop_signal.notify_all();
+	if (reporter.joinable()) {
+		reporter.join();
+	}
+}
+
+void ProgressReporter::Report()
+{
+	unique_lock<mutex> lock(stop_mutex);
+	while (!stop_signal.wait_for(lock, chrono::seconds(interval_seconds), [this]() { return stopping; })) {
+		auto snapshot = progress.Read();
+
+		string phase, units;
+		switch (snapshot.phase) {
+		case Phase::first_phase: phase = "first phase"; units = "letters"; break;
+		case Phase::extension: phase = "extension"; units = "families"; break;
+		case Phase::filters: phase = "filters"; units = "lengths"; break;
+		case Phase::culling: phase = "culling"; units = "lengths"; break;
+		case Phase::footprints: phase = "footprints"; units = "lengths"; break;
+		default: continue;
+		}
+
+		auto rate = snapshot.seconds > 0 ? snapshot.done / snapshot.seconds : 0.0;
+		string line = "[progress] " + title + ": " + phase + ", ";
+		if (snapshot.total > 0) {
+			line += to_string((int)(100.0 * snapshot.done / snapshot.total)) + "% ("
+				+ to_string(snapshot.done) + " of " + to_string(snapshot.total) + " " + units + ")";
+		}
+		else {
+			line += to_string(snapshot.done) + " " + units + " done";
+		}
+		if (snapshot.phase == Phase::extension) {
+			line += ", " + to_string(snapshot.waiting) + " waiting";
+		}
+		line += ", " + to_string((long long)round(rate)) + " " + units + "/s";
+		if (snapshot.total > snapshot.done && rate > 0) {
+			line += ", about " + to_string((long long)ceil((snapshot.total - snapshot.done) / rate)) + " s left";
+		}
+		out << line << endl;
+	}
+}
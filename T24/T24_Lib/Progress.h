@@ -0,0 +1,122 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+#include <iostream>
+
+using namespace std;
+
+/*
+* How far a RepeatFinder has got, and a way to stop it.
+* The finder publishes its phase and a count of the work done in it (letters, families or lengths);
+* the hot loops only store into relaxed atomics, once per chunk of work,
+* and check for cancellation at the same points.
+* A ProgressReporter reads the counts from its own thread, so the finder never waits for the output.
+*/
+enum class Phase
+{
+	waiting,
+	first_phase,
+	extension,
+	filters,
+	culling,
+	footprints,
+	done
+};
+
+// Thrown by the finder at the first check after Cancel() or an interrupt.
+class Cancelled : public exception
+{
+public:
+	const char* what() const noexcept override {
+		return "Cancelled";
+	}
+};
+
+class Progress
+{
+public:
+	// Hot loops call Chunk() with their position and check every chunk_size positions.
+	static const uint64_t chunk_size = 1 << 16;
+
+	struct Snapshot
+	{
+		Phase phase;
+		uint64_t done;
+		uint64_t total; // 0 if not known in advance
+		int64_t waiting; // families still to be extended
+		double seconds; // since the phase started
+	};
+
+	// A new phase, with total units of work if known.
+	void Start(Phase phase, uint64_t total = 0);
+
+	void Set(uint64_t done_so_far) {
+		done.store(done_so_far, memory_order_relaxed);
+	}
+	void Advance(uint64_t units = 1) {
+		done.fetch_add(units, memory_order_relaxed);
+	}
+	void AddWaiting(int64_t families) {
+		waiting.fetch_add(families, memory_order_relaxed);
+	}
+
+	// Set(done_so_far) and check for cancellation, once every chunk_size.
+	void Chunk(uint64_t done_so_far) {
+		if ((done_so_far & (chunk_size - 1)) == 0) {
+			Set(done_so_far);
+			ThrowIfCancelled();
+		}
+	}
+
+	void Cancel() {
+		cancelled.store(true, memory_order_relaxed);
+	}
+	bool IsCancelled() const;
+	void ThrowIfCancelled() const {
+		if (IsCancelled()) {
+			throw Cancelled();
+		}
+	}
+
+	Snapshot Read() const;
+
+private:
+	atomic<int> phase{ (int)Phase::waiting };
+	atomic<uint64_t> done{ 0 };
+	atomic<uint64_t> total{ 0 };
+	atomic<int64_t> waiting{ 0 };
+	atomic<int64_t> started{ 0 }; // steady clock, nanoseconds
+	atomic<bool> cancelled{ false };
+};
+
+// Cancel all the runs on the first Ctrl+C (SIGINT) or SIGTERM; the second one ends the program as usual.
+void cancel_on_interrupt();
+
+/*
+* Prints the progress of a run every interval_seconds, with the throughput
+* and, when the total is known, the time left. Stops when destroyed.
+*/
+class ProgressReporter
+{
+public:
+	ProgressReporter(const Progress& progress, int interval_seconds, string title, ostream& out = cout);
+	~ProgressReporter();
+
+private:
+	const Progress& progress;
+	int interval_seconds;
+	string title;
+	ostream& out;
+
+	mutex stop_mutex;
+	condition_variable stop_signal;
+	bool stopping = false;
+	thread reporter;
+
+	void Report();
+};
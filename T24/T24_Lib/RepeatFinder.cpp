@@ -0,0 +1,1754 @@
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <map>
+
+#include "RepeatFinder.h"
+#include "Error.h"
+#include "CountingFilter.h"
+#include "FamilyFilter.h"
+#include "TaskPool.h"
+#include "ShardFile.h"
+#include "Lce.h"
+
+using namespace std;
+
+RepeatFinder::RepeatFinder(Config config, Process_Type pt, ostream& log, pmr::memory_resource* memory)
+	: config(config), pt(pt), log(log), length2map(memory), length2map_culled(memory)
+{
+	log << "Process type " << (int)pt << endl;
+	switch (pt)
+	{
+	case Process_Type::fpt:
+		config_min_repeat_length = config.fpt_min_repeat_length;
+		config_copy_number = config.fpt_copy_number;
+		break;
+	case Process_Type::crd:
+		config_min_repeat_length = config.crd_min_repeat_length;
+		config_copy_number = config.crd_copy_number;
+		break;
+	default:
+		string msg = "***Unknown process type " + to_string((int)pt);
+		Error().Fatal(msg);
+	}
+
+	for (int c = 0; c < 256; ++c) {
+		complement_table[c] = this->config.complement_of((char)c);
+	}
+
+	if (!lce_select(this->config.simd)) {
+		Error().Warn("Config: simd=" + this->config.simd + " is not available here, comparing with " + lce_isa() + " instead.");
+	}
+	log << "Comparing letters with " << lce_isa() << endl;
+}
+
+/*
+* Both strands: the key of a sequence is the smaller of itself and its reverse complement,
+* so that the copies on either strand fall into the same family.
+* Families keep that key as long as they are in length2map; OrientFamilies() picks
+* the letters they are reported with.
+*/
+string RepeatFinder::Canonical(string seq) const
+{
+	string reverse(seq.rbegin(), seq.rend());
+	for (auto& c : reverse) {
+		c = complement_table[(unsigned char)c];
+	}
+	return reverse < seq ? reverse : seq;
+}
+
+void RepeatFinder::Run(string_view sequence)
+{
+	auto stopwatch_start = chrono::high_resolution_clock::now();
+
+	if (FootprintsOnly()) {
+		FindFootprints(sequence);
+	}
+	else {
+		FindFamilies(sequence);
+		FinishFamilies();
+	}
+
+	// Execution time.
+	auto stopwatch_finish = chrono::high_resolution_clock::now();
+	auto stopwatch_elapsed = stopwatch_finish - stopwatch_start;
+	auto milliseconds = (long)(stopwatch_elapsed.count() / 1000000);
+	auto seconds = (int)round(milliseconds / 1000.0);
+	log << endl
+		<< "Calculations took " << seconds << " seconds." << endl;
+} // Run()
+
+/*
+* Whether only the footprints are needed, and they can be had from the first phase alone, see FindFootprints():
+* no families reported or kept, exact repeats on the forward strand, no filters.
+*/
+bool RepeatFinder::FootprintsOnly()
+{
+	return on_island && !on_family && !on_culled_family && !keep_families
+		&& !config.approximate_requested() && !config.please_only_variable_centers
+		&& !config.please_search_both_strands && !config.filters_requested();
+}
+
+/*
+* The footprints straight from the first phase, without the extension and culling.
+* Every family longer than the minimum is covered by the footprints of the sequences of the minimum length
+* and one letter longer inside it, as every one of those has at least as many copies. So the footprints are:
+*	- of every sequence of the minimum length with enough copies: from the position the first phase registers it at,
+*	  the one right before its letters, for the minimum length;
+*	- of the ones a letter longer that the extension would find (the letter before it in front):
+*	  the same and the last letter of the sequence.
+* Culling leaves the footprints as they are, so they are the ones of the full run, letter for letter.
+*/
+void RepeatFinder::FindFootprints(string_view sequence)
+{
+	fullbuffer = sequence;
+	nblocks = NBlockIndex(fullbuffer, config);
+	reach = regions ? regions->Widened(config_min_repeat_length) : TargetRegions();
+	statistics = RepeatStatistics();
+	statistics.sequence_size = fullbuffer.size();
+	statistics.max_repeat_length = config_min_repeat_length; // not known without the extension
+	seq2positions = SequenceTable<PositionList>(fullbuffer);
+	length2map.clear();
+	length2map_culled.clear();
+
+	log << "Plan: footprints only, from the first phase; no extension and no culling." << endl;
+
+	FindSeeds();
+
+	auto fullbuffer_size = (streamsize)fullbuffer.size();
+	auto min_length = config_min_repeat_length;
+	footprints.assign(fullbuffer.size(), false);
+
+	log << endl << "From the sequences of length " << min_length << ", calculating the footprints... ";
+
+	progress.Start(Phase::footprints, seq2positions.Size());
+	uint64_t done = 0;
+	vector<pair<char, unsigned int>> letters; // the letters before the copies, and how many of each
+	for (auto const& [seq, positions] : seq2positions) {
+		progress.Chunk(++done);
+		letters.clear();
+		for (auto p : positions) {
+			for (auto i = p; i < p + min_length; ++i) {
+				footprints[i] = true;
+			}
+			// As ExtendFamilies() does: not too close to the end.
+			if (p + min_length + 1 >= fullbuffer_size) {
+				continue;
+			}
+			auto letter = fullbuffer[p];
+			auto part = find_if(letters.begin(), letters.end(),
+				[letter](const pair<char, unsigned int>& l) { return l.first == letter; });
+			if (part == letters.end()) {
+				letters.emplace_back(letter, 0);
+				part = letters.end() - 1;
+			}
+			++part->second;
+		}
+		for (auto const& [letter, copies] : letters) {
+			if (copies < config_copy_number) {
+				continue;
+			}
+			for (auto p : positions) {
+				if (p + min_length + 1 < fullbuffer_size && fullbuffer[p] == letter) {
+					footprints[p + min_length] = true;
+				}
+			}
+		}
+	}
+	seq2positions.Clear();
+
+	CountFootprints();
+
+	if (on_island) {
+		EmitIslands();
+	}
+
+	progress.Start(Phase::done);
+} // FindFootprints()
+
+/*
+* First and second phases: length2map with all the families.
+* In a sharded run, only the families whose sequences of the minimum length
+* belong to config.shard, see shard_of().
+*/
+void RepeatFinder::FindFamilies(string_view sequence)
+{
+	fullbuffer = sequence;
+	nblocks = NBlockIndex(fullbuffer, config);
+	reach = regions ? regions->Widened(config_min_repeat_length) : TargetRegions();
+	statistics = RepeatStatistics();
+	statistics.sequence_size = fullbuffer.size();
+	seq2positions = SequenceTable<PositionList>(fullbuffer);
+	length2map.clear();
+	length2map_culled.clear();
+	periodic.clear();
+	seq2offset = SequenceTable<streamsize>(fullbuffer);
+
+	auto stopwatch_start = chrono::high_resolution_clock::now();
+
+	if (config.approximate_requested()) {
+		FindApproximate();
+	}
+	else {
+		FindSeeds();
+
+		// If so requested, calculate the var core sequences from the full buffer.
+		if (config.please_only_variable_centers) {
+			FindVariableCenters();
+		}
+
+		auto stopwatch_finish = chrono::high_resolution_clock::now();
+		auto stopwatch_elapsed = stopwatch_finish - stopwatch_start;
+
+		// Statistics: number of duplicates.
+		long how_many_duplicates = (long)seq2positions.Size();
+		log << how_many_duplicates << " distinct sequences (" << (100.0 * how_many_duplicates / statistics.windows)
+			<< "%) of length " << config_min_repeat_length << " have at least "
+			<< config_copy_number << " copies." << endl;
+
+		// Execution time.
+		long milliseconds = (long)(stopwatch_elapsed.count() / 1000000);
+		auto seconds = (int)round(milliseconds / 1000.0);
+		log << endl
+			<< "First phase took " << seconds << " seconds for "
+			<< statistics.windows << " sequences." << endl;
+
+		if (config.please_search_both_strands) {
+			Extend();
+		}
+		else {
+			ExtendFamilies();
+		}
+	}
+} // FindFamilies()
+
+/*
+* Families from elsewhere, e.g. put together from the shard files, see ShardFile.h.
+* The sequence must stay alive until FinishFamilies() returns.
+*/
+void RepeatFinder::SetFamilies(string_view sequence,
+	FamilyLevels&& families, const RepeatStatistics& found)
+{
+	fullbuffer = sequence;
+	nblocks = NBlockIndex(fullbuffer, config);
+	statistics = found;
+	statistics.sequence_size = fullbuffer.size();
+	statistics.max_repeat_length = config_min_repeat_length;
+	seq2positions = SequenceTable<PositionList>(fullbuffer);
+	length2map = move(families);
+	length2map_culled.clear();
+	periodic.clear();
+	seq2offset = SequenceTable<streamsize>(fullbuffer);
+
+	for (auto const& [seq_length, level] : length2map) {
+		if (!level.Empty()) {
+			statistics.max_repeat_length = max(statistics.max_repeat_length, seq_length);
+		}
+	}
+} // SetFamilies()
+
+/*
+* Incremental runs (see IncrementalState.h), after SetFamilies():
+* families of the minimum length whose copies have changed, extended again into length2map.
+*/
+void RepeatFinder::ExtendSeeds(SequenceTable<PositionList>&& seeds)
+{
+	auto previous_max_repeat_length = statistics.max_repeat_length;
+	seq2positions = move(seeds);
+	ExtendFamilies();
+	statistics.max_repeat_length = max(previous_max_repeat_length, statistics.max_repeat_length);
+} // ExtendSeeds()
+
+/*
+* The rest, from the families in length2map: filters, culling, footprints,
+* with the callbacks called on the way; only the stages that the plan needs.
+*/
+void RepeatFinder::FinishFamilies()
+{
+	progress.Start(Phase::filters);
+
+	FilterFamilies();
+
+	auto plan = Plan();
+
+	if (plan.orient) {
+		OrientFamilies();
+	}
+
+	if (on_family) {
+		EmitFamilies(length2map, on_family);
+	}
+
+	if (plan.cull) {
+		Cull(!plan.keep_families);
+	}
+
+	if (on_culled_family) {
+		EmitFamilies(length2map_culled, on_culled_family);
+	}
+
+	if (plan.footprints) {
+		// Culling only takes out copies inside longer ones, so it leaves the footprints as they are.
+		CalculateFootprints(plan.cull ? length2map_culled : length2map);
+	}
+
+	if (on_island) {
+		EmitIslands();
+	}
+
+	progress.Start(Phase::done);
+} // FinishFamilies()
+
+/*
+* What the callbacks and keep_families need of the stages after the filters;
+* every stage left out is logged.
+*	- Orienting the families on both strands is only for reporting them.
+*	- Culling is for on_culled_family; the footprints are the same without it.
+*	- Culling copies the families unless they are still needed after it; else they are culled in place.
+*	- The footprints are for on_island, and the density with them.
+*/
+RunPlan RepeatFinder::Plan()
+{
+	RunPlan plan;
+	bool reported = on_family || on_culled_family;
+	plan.orient = config.please_search_both_strands && reported;
+	plan.cull = (bool)on_culled_family;
+	plan.keep_families = keep_families || !plan.cull;
+	plan.footprints = (bool)on_island;
+
+	if (config.please_search_both_strands && !plan.orient) {
+		log << "Plan: no families are reported, so they are not oriented." << endl;
+	}
+	if (!plan.cull) {
+		log << "Plan: no culling, no output needs the culled families." << endl;
+	}
+	else if (!plan.keep_families) {
+		log << "Plan: culling in place, no output needs the families before culling after it." << endl;
+	}
+	if (!plan.footprints) {
+		log << "Plan: no footprints, no output needs them." << endl;
+	}
+	return plan;
+} // Plan()
+
+/*
+* First phase.
+* Build a map sequence -> count, or more precisely sequence -> list of positions,
+* and see how many different sequences of length config_min_repeat_length
+* we encounter as a function of the number of input size.
+* Note: the sequence registered at position p is the one starting right after p,
+* the extension below looks at the one starting at p.
+* With config.please_prefilter, a first pass counts the sequences in a CountingFilter,
+* and only those that may have enough copies get into seq2positions.
+* Most sequences are unique, so this saves most of the memory of this phase.
+* With target regions, only the sequences registered in them are keys,
+* and their copies are looked up in the whole sequence: the memory is that of the regions.
+*/
+void RepeatFinder::FindSeeds()
+{
+	auto fullbuffer_size = (streamsize)fullbuffer.size();
+
+	unique_ptr<CountingFilter> filter;
+	bool please_prefilter = config.please_prefilter && !config.please_only_variable_centers && !regions;
+	if (please_prefilter) {
+		filter = make_unique<CountingFilter>((size_t)max((streamsize)0, fullbuffer_size - config_min_repeat_length));
+	}
+	size_t filtered_out = 0;
+
+	// The hash of every window, rolled along with it.
+	RollingHash rolling((size_t)config_min_repeat_length);
+
+	// With target regions, a first pass takes the sequences registered in reach, and only those
+	// are looked up in the whole sequence: the runs of meaningful letters cut to reach,
+	// with the letters of the windows registered at its ends.
+	// Every letter of the regions in the footprints of the whole run is in those of such a sequence,
+	// or of one a letter longer, as in FindFootprints(); so the footprints in the regions are exact.
+	vector<NBlockIndex::Run> target_runs;
+	if (regions) {
+		for (auto const& region : reach.Regions()) {
+			for (auto r = nblocks.RunAfter(region.start + 1); r < nblocks.Runs().size(); ++r) {
+				auto const& run = nblocks.Runs()[r];
+				if (run.start >= region.end + config_min_repeat_length) {
+					break;
+				}
+				target_runs.push_back({ max(run.start, region.start + 1), min(run.end, region.end + config_min_repeat_length) });
+			}
+		}
+	}
+
+	auto passes = please_prefilter || regions ? 2 : 1;
+	auto windows_max = (uint64_t)max((streamsize)0, fullbuffer_size - config_min_repeat_length);
+	progress.Start(Phase::first_phase, passes * windows_max);
+
+	// The windows are the check positions with min_length meaningful letters up to them,
+	// so they are taken run by run of meaningful letters, over the N letters in between at once.
+	statistics.meaningful_letters = nblocks.CountFrom(config_min_repeat_length);
+	for (int pass = passes == 2 ? 0 : 1; pass < 2; ++pass) {
+		bool counting_pass = pass == 0 && please_prefilter;
+		bool targets_pass = pass == 0 && regions;
+		auto done_before = (pass - (2 - passes)) * windows_max;
+
+		for (auto const& run : targets_pass ? target_runs : nblocks.Runs()) {
+			auto first_check = max(run.start + config_min_repeat_length - 1, config_min_repeat_length);
+			if (first_check >= run.end) {
+				continue;
+			}
+
+			// The first window of the run whole, the others rolled on from it.
+			rolling.Reset();
+			for (auto i = first_check + 1 - config_min_repeat_length; i <= first_check; ++i) {
+				rolling.Add(fullbuffer[i]);
+			}
+
+			for (auto check_position = first_check; check_position < run.end; ++check_position) {
+				auto position = check_position - config_min_repeat_length;
+				progress.Chunk(done_before + position);
+				if (check_position > first_check) {
+					rolling.Roll(fullbuffer[check_position], fullbuffer[check_position - config_min_repeat_length]);
+				}
+
+				if (config.please_only_variable_centers) {
+					continue;
+				}
+
+				auto seq = fullbuffer.substr(check_position + 1 - config_min_repeat_length, config_min_repeat_length);
+				string canonical;
+				if (config.please_search_both_strands) {
+					canonical = Canonical(string(seq));
+					seq = canonical;
+				}
+				if (config.sharded() && shard_of(seq, config.shards) != config.shard) {
+					continue;
+				}
+				if (counting_pass) {
+					filter->Add(seq);
+					continue;
+				}
+				if (filter && filter->Estimate(seq) < config_copy_number) {
+					++filtered_out;
+					continue;
+				}
+				auto hash = config.please_search_both_strands ? SequenceTable<PositionList>::Hash(seq) : rolling.Hash();
+				if (targets_pass) {
+					seq2positions.FindOrAdd(seq, hash);
+				}
+				else if (regions) {
+					auto found = seq2positions.Find(seq, hash);
+					if (found != nullptr) {
+						found->Add(position);
+					}
+				}
+				else {
+					seq2positions.FindOrAdd(seq, hash).Add(position);
+				}
+			}
+		} // for each run of meaningful letters
+	}
+	statistics.windows = windows_max;
+
+	if (regions) {
+		// The density is of the regions.
+		statistics.sequence_size = (size_t)regions->Letters();
+		statistics.meaningful_letters = 0;
+		for (auto const& region : regions->Regions()) {
+			auto from = max(region.start, config_min_repeat_length);
+			auto to = max(region.end, config_min_repeat_length);
+			statistics.meaningful_letters += nblocks.CountFrom(from) - nblocks.CountFrom(to);
+		}
+		log << "Target regions: " << regions->Regions().size() << " of " << statistics.sequence_size << " letters, "
+			<< seq2positions.Size() << " distinct sequences registered in them looked up in the whole sequence." << endl;
+	}
+	if (filter) {
+		log << "Prefilter (" << filter->Bytes() / 1024 << " KB) left out " << filtered_out
+			<< " of " << statistics.windows << " sequences." << endl;
+	}
+
+	if (!config.please_only_variable_centers) {
+		// Remove the sequences which appear less than requested.
+		seq2positions.Retain([this](const SequenceTable<PositionList>::Entry& entry) {
+			return entry.second.Size() >= config_copy_number;
+		});
+	}
+} // FindSeeds()
+
+/*
+* Store all the candidate sequences for the variable centers.
+* NOT SeqPalindromeVarCore but:
+* A map from a left arm to another map,
+* the latter from the core size to the list of locations
+* (position of the first element of seq, that is, leftmost).
+*/
+void RepeatFinder::FindVariableCenters()
+{
+	unordered_map<string, unordered_map<int, vector<int>>> seq_varcore2locations;
+
+	/*
+	* Look at core candidates:
+	*	positions from (in arm length) to (input length) - (min arm length)
+	*	sizes from 0 to (max core size)
+	* At each core candidate, look at arm candidates:
+	*	arms of length (min arm length) to until the arms are not reverse of each other
+	* Every time we have a seq candidate that fits the above constraints, remember it in the map.
+	* Afterwards, can sift them out by count.
+	*/
+	auto input_size = (streamsize)fullbuffer.size();
+	auto min_repeat_count = config_copy_number;
+	auto min_arm_length = config.palindrome_arm;
+	auto max_core_size = config.palindrome_center;
+	progress.Start(Phase::first_phase, (uint64_t)input_size);
+	for (streamsize core_position = 0; core_position < input_size; ++core_position) {
+		progress.Chunk((uint64_t)core_position);
+		for (auto core_size = 0; core_size < max_core_size; ++core_size) {
+			if (core_position + core_size + min_arm_length >= input_size) {
+				break;
+			}
+
+			// Look at seq candidates around the given core:
+			// the arms go on as long as the letters to the left mirror those to the right
+			// (the complement is its own inverse, so either side can be complemented).
+			auto right_start = core_position + core_size;
+			auto arm_max = (size_t)min(core_position, input_size - right_start);
+			size_t arms = 0;
+			if (arm_max > 0) {
+				arms = config.complement_defined()
+					? lce_mirror(&fullbuffer[right_start], &fullbuffer[core_position - 1], arm_max, complement_table)
+					: lce_mirror(&fullbuffer[right_start], &fullbuffer[core_position - 1], arm_max);
+			}
+			for (streamsize arm_length = max(min_arm_length, 1); arm_length <= (streamsize)arms; ++arm_length) {
+				auto left_pos = core_position - arm_length;
+				auto the_left_arm = string(fullbuffer.substr(left_pos, arm_length));
+				seq_varcore2locations[the_left_arm][core_size].push_back((int)left_pos);
+			} // extending the arm
+		} // growing the core size
+	} // moving the core position
+
+	// Leave only the ones that appear a sufficient number of times.
+	auto iter_seq = seq_varcore2locations.begin();
+	while (iter_seq != seq_varcore2locations.end()) {
+		auto iter_corecounts = iter_seq->second.begin();
+		while (iter_corecounts != iter_seq->second.end()) {
+			auto the_count = iter_corecounts->second.size();
+			if (the_count < min_repeat_count) {
+				iter_corecounts = iter_seq->second.erase(iter_corecounts);
+			}
+			else {
+				++iter_corecounts;
+			}
+		}
+		if (iter_seq->second.empty()) {
+			iter_seq = seq_varcore2locations.erase(iter_seq);
+			continue;
+		}
+		++iter_seq;
+	}
+
+	// Rebuild seq2positions
+	// which is used for further processing.
+	// TODO
+} // FindVariableCenters()
+
+/*
+* Second phase.
+* Extend the sequences, as far as possible.
+*/
+void RepeatFinder::Extend()
+{
+	auto fullbuffer_size = (streamsize)fullbuffer.size();
+
+	// PREPROCESSING FOR BUILDING LONGER SEQUENCES
+	// Starting positions in order, so that the position lists are built in order.
+	vector<streamsize> starts;
+	for (auto const& [s, pp] : seq2positions) {
+		for (auto p : pp) {
+			starts.push_back(p);
+		}
+	}
+	sort(starts.begin(), starts.end());
+
+	log << "The total number of such sequences, including duplicates, is "
+		<< starts.size() << " (so, "
+		<< starts.size() / (double)seq2positions.Size() << " copies on average)." << endl;
+
+	// The families of every length are those of seq2positions, which starts anew for the next length.
+	length2map.insert_or_assign(config_min_repeat_length, move(seq2positions));
+	seq2positions = SequenceTable<PositionList>(fullbuffer);
+
+	progress.Start(Phase::extension);
+	auto seq_length_max = config_min_repeat_length; // max observed
+	for (auto seq_length = config_min_repeat_length + 1; ; ++seq_length) {
+		progress.ThrowIfCancelled();
+
+		// Try to extend each sequence by appending the next character
+		// to each of the sequences from the previous step.
+
+		try {
+			seq2positions.Clear();
+
+			// Calculate seq2positions for all sequences of length seq_length.
+			for (auto start : starts) {
+				if (start + seq_length >= fullbuffer_size) {
+					// prefix too close to the end
+					continue;
+				}
+
+				if (!nblocks.IsValid(start + seq_length - 1)) {
+					// the next letter cannot be in seq
+					continue;
+				}
+				if (seq_length == config_min_repeat_length + 1 && !nblocks.IsValid(start)) {
+					// nor the letter before, where the first phase registers the sequence
+					continue;
+				}
+
+				auto seq = fullbuffer.substr(start, seq_length);
+				string canonical;
+				if (config.please_search_both_strands) {
+					canonical = Canonical(string(seq));
+					seq = canonical;
+				}
+				seq2positions[seq].Add(start);
+			}
+
+			log << endl << "Sequence length " << seq_length
+				<< ". Total " << seq2positions.Size() << " distinct sequences." << endl;
+
+			// Only leave seq2positions where seq appears enough, with a copy in reach if any.
+			seq2positions.Retain([this](const SequenceTable<PositionList>::Entry& entry) {
+				if (entry.second.Size() < config_copy_number) {
+					return false;
+				}
+				if (!regions) {
+					return true;
+				}
+				for (auto p : entry.second) {
+					if (reach.Contains(p)) {
+						return true;
+					}
+				}
+				return false;
+			});
+
+			log << seq2positions.Size() << " of them appear enough";
+			progress.Advance(seq2positions.Size());
+
+			if (seq2positions.Empty()) {
+				log << "." << endl << endl;
+				break; // leave the loop
+			}
+
+			// The starts for the next seq_length
+			starts.clear();
+			for (auto const& [s, plist] : seq2positions) {
+				for (auto p : plist) {
+					starts.push_back(p);
+				}
+			}
+			sort(starts.begin(), starts.end());
+
+			log << ", for a total of " << starts.size() << " sequences (counting all copies)." << endl;
+
+			// Update length2map.
+			length2map.insert_or_assign(seq_length, move(seq2positions));
+			seq2positions = SequenceTable<PositionList>(fullbuffer);
+
+			seq_length_max = seq_length;
+		}
+		catch (exception ex) {
+			seq_length_max = seq_length - 1;
+			break;
+		}
+	} // for seq_length
+
+	seq2positions.Clear();
+	statistics.max_repeat_length = seq_length_max;
+} // Extend()
+
+// The families of from go into to; a family in both gets the copies of both.
+static void merge_level(FamilyLevel& to, FamilyLevel&& from)
+{
+	if (to.Empty()) {
+		to = move(from);
+		return;
+	}
+	for (auto& [seq, positions] : from) {
+		auto& copies = to[seq];
+		if (copies.Empty()) {
+			copies = move(positions);
+		}
+		else {
+			copies.Merge(positions);
+		}
+	}
+}
+
+// The copies of all the families of a level.
+static size_t copy_count_of(const FamilyLevel& level)
+{
+	size_t count = 0;
+	for (auto const& [seq, positions] : level) {
+		count += positions.Size();
+	}
+	return count;
+}
+
+/*
+* Second phase, one family at a time.
+* The copies of a family of length seq_length that go on to length seq_length + 1
+* split by the letter they go on with; each part with enough copies is a family again,
+* and is extended the same way until none is left.
+* Every family is a task for a TaskPool, so that satellites with many copies
+* and the many small families spread evenly over config.threads cores.
+* Gives the same length2map as Extend(), which is still used for both strands:
+* there, a family of the next length can come from two families of this one.
+* In a periodic run of R letters, e.g. a homopolymer or a tandem array, a family has a copy every period
+* and so have its extensions up to about R letters, that is R copies at each of R lengths.
+* Such copies, a period apart with their letters overlapping, are taken out of the positions
+* as PeriodicCopies, which stand for all of them at every length, and are left in periodic;
+* the copies that reach the end of the run go on as ordinary ones. Not when the families
+* are read after the run, go to a shard file or through the filters, which need every copy in length2map.
+*/
+void RepeatFinder::ExtendFamilies()
+{
+	auto fullbuffer_size = (streamsize)fullbuffer.size();
+	auto min_length = config_min_repeat_length;
+	bool periodic_allowed = !keep_families && !config.sharded() && !config.filters_requested();
+	const size_t periodic_min_copies = 4; // fewer copies a period apart stay in positions
+	const auto open_ended = numeric_limits<streamsize>::max(); // longest of PeriodicCopies still extended
+
+	struct Family
+	{
+		streamsize length = 0;
+		vector<streamsize> positions = {}; // in increasing order
+		vector<PeriodicCopies> periodic = {}; // copies in periodic runs, not in positions
+	};
+
+	// What each worker found, put together at the end.
+	struct Found
+	{
+		FamilyLevels length2map;
+		unordered_map<streamsize, size_t> length2families = {};
+		unordered_map<streamsize, streamsize> length2periodic = {}; // copies in periodic, per length
+		vector<PeriodicCopies> periodic = {};
+		streamsize seq_length_max = 0;
+		string failure = ""; // why the worker stopped, if it did
+	};
+
+	// In the memory of length2map, so that they merge into it without copying.
+	TaskPool pool(config.threads);
+	vector<Found> found;
+	for (int worker = 0; worker < pool.Threads(); ++worker) {
+		found.push_back(Found{ FamilyLevels(length2map.get_allocator()) });
+	}
+
+	auto copy_count = [](const Family& family, streamsize seq_length) {
+		auto count = (streamsize)family.positions.size();
+		for (auto const& copies : family.periodic) {
+			count += copies.CountAt(seq_length);
+		}
+		return count;
+	};
+
+	// With target regions, a family needs a copy in reach, see FindSeeds(); its extensions have no other copies.
+	auto in_regions = [this](const Family& family) {
+		if (!regions) {
+			return true;
+		}
+		for (auto p : family.positions) {
+			if (reach.Contains(p)) {
+				return true;
+			}
+		}
+		for (auto const& copies : family.periodic) {
+			auto last = copies.first + (copies.CountAt(family.length) - 1) * copies.period;
+			if (reach.ContainsAny(copies.first, copies.period, last)) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// Register the copies of family as a family of seq_length.
+	auto record = [&](Found& mine, const Family& family, streamsize seq_length) {
+		auto first = family.positions.empty() ? family.periodic.front().first : family.positions.front();
+		auto seq = fullbuffer.substr(first, seq_length);
+		auto& registered = level_of(mine.length2map, seq_length, fullbuffer)[seq];
+		for (auto p : family.positions) {
+			registered.Add(p);
+		}
+		for (auto const& copies : family.periodic) {
+			mine.length2periodic[seq_length] += copies.CountAt(seq_length);
+		}
+		++mine.length2families[seq_length];
+		mine.seq_length_max = max(mine.seq_length_max, seq_length);
+	};
+
+	// The copies that stop being in a family at seq_length: their last length is seq_length - 1.
+	auto close = [&](Found& mine, vector<PeriodicCopies>& periodic, streamsize seq_length) {
+		for (auto& copies : periodic) {
+			copies.longest = seq_length - 1;
+			mine.periodic.push_back(copies);
+		}
+		periodic.clear();
+	};
+
+	// Copies a period apart whose letters overlap or touch are in a periodic run of that period:
+	// the run goes on as long as its letters repeat and are meaningful.
+	auto find_periodic = [&](Family& family) {
+		auto& positions = family.positions;
+		vector<streamsize> rest;
+		size_t i = 0;
+		while (i + 1 < positions.size()) {
+			auto period = positions[i + 1] - positions[i];
+			auto j = i + 1; // the last copy a period apart
+			while (j + 1 < positions.size() && positions[j + 1] - positions[j] == period) {
+				++j;
+			}
+			if (period <= family.length && j - i + 1 >= periodic_min_copies) {
+				auto first = positions[i];
+				auto limit = (size_t)(fullbuffer_size - 1 - (first + period)); // as copies, up to the last letter
+				auto end = first + period + (streamsize)lce_forward(&fullbuffer[first], &fullbuffer[first + period], limit);
+				end = first + nblocks.ValidFrom(first, end - first);
+				if (positions[j] + family.length <= end) {
+					family.periodic.push_back(PeriodicCopies{ first, period, (streamsize)(j - i + 1),
+						end, family.length, open_ended });
+					i = j + 1;
+					continue;
+				}
+			}
+			rest.insert(rest.end(), positions.begin() + i, positions.begin() + j);
+			i = j;
+		}
+		if (family.periodic.empty()) {
+			return;
+		}
+		rest.insert(rest.end(), positions.begin() + i, positions.end());
+		positions = move(rest);
+	};
+
+	function<void(const Family&, int)> extend = [&](const Family& family, int worker) {
+		progress.AddWaiting(-1);
+		if (progress.IsCancelled()) {
+			return; // the tasks left are dropped
+		}
+		progress.Advance();
+		auto& mine = found[worker];
+		auto length = family.length;
+		try {
+			// As long as all the copies go on with the same letters, the family does not split:
+			// find how long that is in one go, rather than letter by letter.
+			// Periodic copies go on with the letters of their run until its end.
+			if (length > min_length) {
+				auto first = family.positions.empty() ? family.periodic.front().first : family.positions.front();
+				auto run = family.positions.empty() ? fullbuffer_size
+					: fullbuffer_size - 1 - (family.positions.back() + length); // to the end, for the last copy
+				for (auto const& copies : family.periodic) {
+					auto last = copies.first + (copies.CountAt(length) - 1) * copies.period;
+					run = min(run, copies.end - (last + length));
+				}
+				for (auto p : family.positions) {
+					if (run <= 0) {
+						break;
+					}
+					if (p != first) {
+						run = (streamsize)lce_forward(&fullbuffer[first + length], &fullbuffer[p + length], (size_t)run);
+					}
+				}
+				for (auto const& copies : family.periodic) {
+					if (run <= 0) {
+						break;
+					}
+					if (copies.first != first) {
+						run = (streamsize)lce_forward(&fullbuffer[first + length], &fullbuffer[copies.first + length], (size_t)run);
+					}
+				}
+				if (run > 0) {
+					auto valid = nblocks.ValidFrom(first + length, run);
+					for (streamsize i = 0; i < valid; ++i) {
+						record(mine, family, ++length);
+					}
+				}
+			}
+
+			auto seq_length = length + 1;
+			vector<pair<char, Family>> parts;
+			auto part_of = [&](char letter) -> Family& {
+				auto part = find_if(parts.begin(), parts.end(),
+					[letter](const pair<char, Family>& p) { return p.first == letter; });
+				if (part == parts.end()) {
+					parts.emplace_back(letter, Family{ seq_length });
+					part = parts.end() - 1;
+				}
+				return part->second;
+			};
+			auto add = [&](streamsize start) {
+				if (start + seq_length >= fullbuffer_size) {
+					// prefix too close to the end
+					return;
+				}
+				// The first phase registers a sequence at the position right before it,
+				// so from there the new letter is the one at start.
+				auto letter_at = length == min_length ? start : start + seq_length - 1;
+				if (!nblocks.IsValid(letter_at)) {
+					// the new letter cannot be in seq
+					return;
+				}
+				part_of(fullbuffer[letter_at]).positions.push_back(start);
+			};
+			for (auto start : family.positions) {
+				add(start);
+			}
+			for (auto copies : family.periodic) {
+				// The last copies reach the end of the run.
+				auto staying = copies.CountAt(seq_length);
+				for (auto j = staying; j < copies.CountAt(length); ++j) {
+					add(copies.first + j * copies.period);
+				}
+				if (staying == 0) {
+					copies.longest = length;
+					mine.periodic.push_back(copies);
+				}
+				else {
+					part_of(fullbuffer[copies.first + length]).periodic.push_back(copies);
+				}
+			}
+
+			for (auto& [letter, part] : parts) {
+				if (copy_count(part, seq_length) < (streamsize)config_copy_number || !in_regions(part)) {
+					close(mine, part.periodic, seq_length);
+					continue;
+				}
+				if (!family.periodic.empty() && !is_sorted(part.positions.begin(), part.positions.end())) {
+					sort(part.positions.begin(), part.positions.end());
+				}
+				if (periodic_allowed) {
+					find_periodic(part);
+				}
+
+				record(mine, part, seq_length);
+
+				progress.AddWaiting(1);
+				pool.Submit([&extend, child = move(part)](int w) {
+					extend(child, w);
+				}, worker);
+			}
+		}
+		catch (const exception& ex) {
+			mine.failure = ex.what();
+		}
+	};
+
+	// Minimum length: from the first phase.
+	progress.Start(Phase::extension);
+	size_t seed_copies = 0;
+	for (auto const& [s, pp] : seq2positions) {
+		seed_copies += pp.Size();
+		progress.AddWaiting(1);
+		pool.Submit([&extend, seed = Family{ min_length, vector<streamsize>(pp.begin(), pp.end()) }](int w) {
+			extend(seed, w);
+		});
+	}
+
+	log << "The total number of such sequences, including duplicates, is "
+		<< seed_copies << " (so, "
+		<< seed_copies / (double)seq2positions.Size() << " copies on average)." << endl;
+
+	// The tasks have their own copies of the positions.
+	merge_level(level_of(length2map, min_length, fullbuffer), move(seq2positions));
+	seq2positions = SequenceTable<PositionList>(fullbuffer);
+
+	log << "Extending on " << pool.Threads() << " threads." << endl;
+	pool.Run();
+	progress.ThrowIfCancelled();
+
+	auto seq_length_max = min_length; // max observed
+	map<streamsize, size_t> length2families;
+	unordered_map<streamsize, streamsize> length2periodic;
+	string failure;
+	for (auto& mine : found) {
+		for (auto& [seq_length, level] : mine.length2map) {
+			merge_level(level_of(length2map, seq_length, fullbuffer), move(level));
+		}
+		for (auto const& [seq_length, families] : mine.length2families) {
+			length2families[seq_length] += families;
+		}
+		for (auto const& [seq_length, copies] : mine.length2periodic) {
+			length2periodic[seq_length] += copies;
+		}
+		periodic.insert(periodic.end(), mine.periodic.begin(), mine.periodic.end());
+		seq_length_max = max(seq_length_max, mine.seq_length_max);
+		if (failure.empty()) {
+			failure = mine.failure;
+		}
+	}
+	sort(periodic.begin(), periodic.end(), [](const PeriodicCopies& a, const PeriodicCopies& b) {
+		return a.longest > b.longest || (a.longest == b.longest && a.first < b.first);
+	});
+
+	for (auto const& [seq_length, families] : length2families) {
+		log << endl << "Sequence length " << seq_length << ". "
+			<< families << " distinct sequences appear enough, for a total of "
+			<< copy_count_of(length2map[seq_length]) + length2periodic[seq_length] << " sequences (counting all copies)." << endl;
+	}
+	log << endl;
+	if (!periodic.empty()) {
+		log << "Copies in periodic runs: kept as " << periodic.size() << " records." << endl;
+	}
+
+	if (!failure.empty()) {
+		Error().Warn("Extension ran out of resources (" + failure + "); some repeats may be longer than reported.");
+	}
+
+	statistics.max_repeat_length = seq_length_max;
+} // ExtendFamilies()
+
+// Length over which the copy at c stays within the allowed mismatches from the repeat at r,
+// at most max_length.
+static streamsize mismatch_extent(const PackedSequence& packed, streamsize r, streamsize c,
+	streamsize max_length, int mismatches)
+{
+	auto remaining = mismatches;
+	for (streamsize offset = 0; offset < max_length; offset += 64) {
+		auto differ = packed.Mismatches((size_t)(r + offset), (size_t)(c + offset));
+		if (max_length - offset < 64) {
+			differ &= ((uint64_t)1 << (max_length - offset)) - 1;
+		}
+		auto count = popcount64(differ);
+		if (count > remaining) {
+			// Drop the mismatches still allowed, the next one ends the copy.
+			for (auto i = 0; i < remaining; ++i) {
+				differ &= differ - 1;
+			}
+			return offset + lowest_bit64(differ);
+		}
+		remaining -= count;
+	}
+	return max_length;
+}
+
+/*
+* The seeds of approximate repeats: the first blocks * block_length letters of a window,
+* split into blocks, and the patterns of the blocks whose letters make a key.
+*/
+struct SeedPatterns
+{
+	streamsize block_length = 0;
+	vector<vector<streamsize>> patterns; // the blocks of each pattern, in increasing order
+
+	streamsize Weight() const {
+		return patterns.empty() ? 0 : block_length * (streamsize)patterns[0].size();
+	}
+};
+
+// With d mismatches and d + s blocks, s of the blocks have no mismatch,
+// so a copy shares with the repeat the letters of one of the C(d + s, s) patterns of s blocks.
+// A larger s gives heavier, more selective keys, and more of them:
+// the first s whose keys have target_weight letters, else the heaviest,
+// with at most max_patterns patterns and max_weight letters to a key.
+static SeedPatterns seed_patterns(streamsize min_length, int mismatches, streamsize max_weight)
+{
+	const size_t max_patterns = 16;
+	const streamsize target_weight = 12;
+
+	SeedPatterns best;
+	for (streamsize s = 1; best.Weight() < target_weight; ++s) {
+		auto blocks = mismatches + s;
+		auto block_length = min(min_length / blocks, max_weight / s);
+		size_t count = 1; // C(blocks, s)
+		for (streamsize i = 1; i <= s; ++i) {
+			count = count * (size_t)(blocks - s + i) / (size_t)i;
+		}
+		if (block_length == 0 || count > max_patterns) {
+			break;
+		}
+		if (block_length * s <= best.Weight()) {
+			continue;
+		}
+
+		best.block_length = block_length;
+		best.patterns.clear();
+		vector<streamsize> pattern((size_t)s);
+		for (streamsize i = 0; i < s; ++i) {
+			pattern[(size_t)i] = i;
+		}
+		while (true) {
+			best.patterns.push_back(pattern);
+			// The next combination, in lexicographic order.
+			auto i = s - 1;
+			while (i >= 0 && pattern[(size_t)i] == blocks - s + i) {
+				--i;
+			}
+			if (i < 0) {
+				break;
+			}
+			++pattern[(size_t)i];
+			for (auto j = i + 1; j < s; ++j) {
+				pattern[(size_t)j] = pattern[(size_t)(j - 1)] + 1;
+			}
+		}
+	}
+	return best;
+}
+
+/*
+* First and second phases for approximate repeats: the copies may differ from the repeat
+* in up to config.max_mismatches letters (substitutions only).
+*
+* Candidates come from seeds, see seed_patterns(): every window gets a key per pattern,
+* made of the letters of its blocks, and windows r and c are candidates when they share a key.
+* Splitting the window in more blocks than d + 1 keeps the keys selective with several mismatches,
+* e.g. 12 letters rather than 6 for 20 letters and 2 mismatches, at the cost of more patterns,
+* each of them a group index of 4 bytes per letter.
+* The windows sharing a key are taken in groups of at most max_group, in order of positions,
+* so that a low complexity key does not make every window a candidate of every other one;
+* a family with more copies than that may be found as several.
+* Each candidate is verified and extended against the repeat (the leftmost window still free)
+* with PackedSequence, 64 letters at a time. The copies of a repeat do not overlap one another:
+* in a periodic run, where every letter would start a copy at every length, they are min_length apart.
+* A repeat goes into length2map at every length where its number of copies changes,
+* so the filters, culling, footprints and output files treat it like the exact ones.
+* A window that became a copy is not looked at again.
+*/
+void RepeatFinder::FindApproximate()
+{
+	auto stopwatch_start = chrono::high_resolution_clock::now();
+
+	auto fullbuffer_size = (streamsize)fullbuffer.size();
+	auto min_length = config_min_repeat_length;
+	auto mismatches = config.max_mismatches;
+
+	if (mismatches >= min_length) {
+		Error().Fatal("Config: max_mismatches is " + to_string(mismatches)
+			+ " but should be less than the minimum repeat length " + to_string(min_length));
+	}
+
+	// Meaningful letters, counted as in the first phase.
+	statistics.meaningful_letters = nblocks.CountFrom(min_length);
+	statistics.windows = max((streamsize)0, fullbuffer_size - min_length);
+
+	auto mapped = packed_input != nullptr && packed_input->Size() == fullbuffer.size()
+		&& packed_input->Alphabet() == PackedSequence::Alphabet(config.letters);
+	if (mapped) {
+		log << "Using the letters as packed in the input file." << endl;
+	}
+	auto packed = mapped ? PackedSequence(*packed_input) : PackedSequence(fullbuffer, config.letters);
+	auto bits = packed.Bits();
+
+	auto seeds = seed_patterns(min_length, mismatches, (streamsize)(64 / bits));
+	auto weight = seeds.Weight();
+	if (weight < 8) {
+		Error().Warn("Seeds of " + to_string(weight) + " letters are not selective,"
+			" approximate repeats may take long. Consider fewer mismatches or longer repeats.");
+	}
+	auto block_length = seeds.block_length;
+	auto block_bits = block_length * bits;
+
+	// The letters of the block starting at every position; invalid_block if one is not valid.
+	const uint64_t invalid_block = UINT64_MAX;
+	vector<uint64_t> block_code((size_t)fullbuffer_size, invalid_block);
+	{
+		uint64_t code = 0;
+		streamsize valid_letters = 0;
+		uint64_t block_mask = block_bits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << block_bits) - 1;
+		for (streamsize x = 0; x < fullbuffer_size; ++x) {
+			if (!packed.IsValid((size_t)x)) {
+				valid_letters = 0;
+				continue;
+			}
+			code = ((code << bits) | packed.Code((size_t)x)) & block_mask;
+			if (++valid_letters >= block_length) {
+				block_code[(size_t)(x - block_length + 1)] = code;
+			}
+		}
+	}
+
+	// Groups of windows sharing a key, per pattern; single windows are no use.
+	const uint32_t no_group = UINT32_MAX;
+	const size_t max_group = 1 << 12;
+	vector<vector<uint32_t>> group_of(seeds.patterns.size());
+	vector<streamsize> group_members;
+	vector<size_t> group_begin;
+	vector<pair<uint64_t, streamsize>> keys;
+	for (size_t p = 0; p < seeds.patterns.size(); ++p) {
+		auto& pattern = seeds.patterns[p];
+		auto reach = (pattern.back() + 1) * block_length;
+		keys.clear();
+		for (streamsize x = 0; x + reach <= fullbuffer_size; ++x) {
+			uint64_t key = 0;
+			bool valid = true;
+			for (auto block : pattern) {
+				auto code = block_code[(size_t)(x + block * block_length)];
+				if (code == invalid_block) {
+					valid = false;
+					break;
+				}
+				key = block_bits >= 64 ? code : (key << block_bits) | code;
+			}
+			if (valid) {
+				keys.emplace_back(key, x);
+			}
+		}
+		sort(keys.begin(), keys.end());
+
+		group_of[p].assign((size_t)fullbuffer_size, no_group);
+		for (size_t i = 0; i < keys.size(); ) {
+			auto j = i + 1;
+			while (j < keys.size() && keys[j].first == keys[i].first) {
+				++j;
+			}
+			if (j - i >= 2) {
+				for (auto first = i; first < j; first += max_group) {
+					auto last = min(j, first + max_group);
+					auto group = (uint32_t)group_begin.size();
+					group_begin.push_back(group_members.size());
+					for (auto k = first; k < last; ++k) {
+						group_members.push_back(keys[k].second);
+						group_of[p][(size_t)keys[k].second] = group;
+					}
+				}
+			}
+			i = j;
+		}
+	}
+	group_begin.push_back(group_members.size());
+	keys.clear();
+	keys.shrink_to_fit();
+	block_code.clear();
+	block_code.shrink_to_fit();
+
+	vector<bool> claimed((size_t)fullbuffer_size, false);
+	vector<streamsize> candidates;
+	vector<pair<streamsize, streamsize>> copies; // extent, start
+	vector<streamsize> starts; // of the copies at one length
+	streamsize run_end = 0; // where the valid letters go on to from r
+	long how_many_repeats = 0;
+	streamsize seq_length_max = min_length;
+
+	progress.Start(Phase::first_phase, (uint64_t)fullbuffer_size);
+	for (streamsize r = 0; r + min_length <= fullbuffer_size; ++r) {
+		progress.Chunk((uint64_t)r);
+		auto valid = nblocks.ValidFrom(r, min_length);
+		if (valid < min_length) {
+			// No window here: on to the next run of meaningful letters.
+			auto next = nblocks.RunAfter(r + valid);
+			r = (next < nblocks.Runs().size() ? nblocks.Runs()[next].start : fullbuffer_size) - 1;
+			continue;
+		}
+		if (claimed[(size_t)r]) {
+			continue;
+		}
+
+		candidates.clear();
+		for (auto const& groups : group_of) {
+			auto group = groups[(size_t)r];
+			if (group == no_group) {
+				continue;
+			}
+			for (auto m = group_begin[group]; m < group_begin[group + 1]; ++m) {
+				auto c = group_members[m];
+				if (c == r || claimed[(size_t)c]) {
+					continue;
+				}
+				candidates.push_back(c);
+			}
+		}
+		if (candidates.size() + 1 < config_copy_number) {
+			continue;
+		}
+		sort(candidates.begin(), candidates.end());
+		candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+		if (candidates.size() + 1 < config_copy_number) {
+			continue;
+		}
+
+		if (run_end <= r) {
+			run_end = r + (streamsize)packed.ValidRun((size_t)r);
+		}
+		auto repeat_extent = run_end - r;
+		if (repeat_extent < min_length) {
+			continue;
+		}
+
+		// The copies do not overlap: each one ends where the next one starts, at the latest,
+		// and one closer than min_length to the previous one is not even verified.
+		// In a periodic run, the copies are then min_length apart rather than at every letter.
+		auto copy_extent = [&](streamsize c) {
+			auto extent = mismatch_extent(packed, r, c, repeat_extent, mismatches);
+			return (streamsize)packed.ValidRun((size_t)c, (size_t)extent);
+		};
+		auto after = lower_bound(candidates.begin(), candidates.end(), r);
+		copies.clear();
+		copies.emplace_back(repeat_extent, r);
+		for (auto it = after; it != candidates.end(); ++it) {
+			auto& previous = copies.back();
+			if (*it - previous.second < min_length) {
+				continue;
+			}
+			auto extent = copy_extent(*it);
+			if (extent >= min_length) {
+				previous.first = min(previous.first, *it - previous.second);
+				if (copies.size() == 1) {
+					repeat_extent = previous.first;
+				}
+				copies.emplace_back(min(extent, repeat_extent), *it);
+			}
+		}
+		auto next = r;
+		for (auto it = after; it != candidates.begin(); ) {
+			auto c = *--it;
+			if (next - c < min_length) {
+				continue;
+			}
+			auto extent = min(copy_extent(c), next - c);
+			if (extent >= min_length) {
+				copies.emplace_back(extent, c);
+				next = c;
+			}
+		}
+		if (copies.size() < config_copy_number) {
+			continue;
+		}
+
+		// Longest first; the repeat itself is never shorter than its copies.
+		sort(copies.begin(), copies.end(), [](const pair<streamsize, streamsize>& a, const pair<streamsize, streamsize>& b) {
+			return a.first > b.first || (a.first == b.first && a.second < b.second);
+		});
+
+		// Record the repeat at every length where its number of copies changes.
+		for (size_t j = config_copy_number - 1; j < copies.size(); ++j) {
+			auto length = copies[j].first;
+			if (j + 1 < copies.size() && copies[j + 1].first == length) {
+				continue;
+			}
+			auto seq = fullbuffer.substr((size_t)r, (size_t)length);
+			starts.clear();
+			for (size_t i = 0; i <= j; ++i) {
+				starts.push_back(copies[i].second);
+			}
+			sort(starts.begin(), starts.end());
+			PositionList positions;
+			for (auto start : starts) {
+				positions.Add(start);
+			}
+			level_of(length2map, length, fullbuffer)[seq].Merge(positions);
+			seq2offset[seq] = r;
+			seq_length_max = max(seq_length_max, length);
+		}
+
+		for (auto const& copy : copies) {
+			claimed[(size_t)copy.second] = true;
+		}
+		++how_many_repeats;
+	}
+
+	statistics.max_repeat_length = seq_length_max;
+
+	auto stopwatch_finish = chrono::high_resolution_clock::now();
+	auto stopwatch_elapsed = stopwatch_finish - stopwatch_start;
+	long milliseconds = (long)(stopwatch_elapsed.count() / 1000000);
+	auto seconds = (int)round(milliseconds / 1000.0);
+	log << how_many_repeats << " approximate repeats of length at least " << min_length
+		<< " with up to " << mismatches << " mismatches have at least "
+		<< config_copy_number << " copies, the longest is " << seq_length_max << " long." << endl;
+	log << endl
+		<< "Approximate repeats took " << seconds << " seconds for "
+		<< statistics.windows << " sequences, with " << seeds.patterns.size() << " seeds of " << weight << " letters." << endl;
+} // FindApproximate()
+
+/*
+* The filters of config, see FamilyFilter.h, all in one pass:
+* the families of every level are tested in parallel chunks, every one once,
+* and then the families turned down are taken out of their levels.
+*/
+void RepeatFinder::FilterFamilies()
+{
+	FamilyFilter filter(config, complement_table);
+	if (!filter.Active()) {
+		return;
+	}
+	log << "Filters: " << filter.Description() << "." << endl;
+
+	// The families of every level, in chunks of up to chunk_families.
+	struct Chunk
+	{
+		FamilyLevel* level = nullptr;
+		size_t first = 0; // entries of level, from first to last, exclusive
+		size_t last = 0;
+		size_t copies = 0;
+		size_t turned_down = 0; // copies
+	};
+	const size_t chunk_families = 1 << 12;
+	vector<Chunk> chunks;
+	for (auto& [seq_length, level] : length2map) {
+		for (size_t first = 0; first < level.Size(); first += chunk_families) {
+			chunks.push_back(Chunk{ &level, first, min(level.Size(), first + chunk_families) });
+		}
+	}
+
+	TaskPool pool(config.threads);
+	for (auto& chunk : chunks) {
+		pool.Submit([&](int) {
+			if (progress.IsCancelled()) {
+				return;
+			}
+			// A family turned down is left without copies.
+			auto entries = chunk.level->begin();
+			for (auto i = chunk.first; i < chunk.last; ++i) {
+				auto& [seq, positions] = entries[i];
+				chunk.copies += positions.Size();
+				if (!filter.Keep(seq)) {
+					chunk.turned_down += positions.Size();
+					positions.Clear();
+				}
+			}
+			progress.Advance(chunk.copies);
+		});
+	}
+	pool.Run();
+	progress.ThrowIfCancelled();
+
+	size_t turned_down = 0, copies = 0;
+	for (auto const& chunk : chunks) {
+		copies += chunk.copies;
+		turned_down += chunk.turned_down;
+	}
+	for (auto& [seq_length, level] : length2map) {
+		level.Retain([](const FamilyLevel::Entry& entry) {
+			return !entry.second.Empty();
+		});
+	}
+	log << turned_down << " of " << copies << " sequences (counting all copies) turned down by the filters." << endl;
+} // FilterFamilies()
+
+/*
+* Culling: every copy inside a longer one goes, whatever its family.
+* Logic:
+*	- Sort the copies by start, and the longer ones first at the same start.
+*	- A copy is inside a longer one exactly when it does not end past all the copies before it;
+*		so only the longest copy at every start can be left, and one pass over them finds those that are.
+*	- The copies of periodic are sorted in with the others, and those left are put into length2map_culled.
+*	- Note: at the end of this process, some of the remaining sequences may appear less than 3 times.
+*		Just leave them in for now.
+*/
+void RepeatFinder::Cull(bool in_place)
+{
+	log << "Culling... ";
+
+	// Working on length2map, generating length2map_culled; in place, length2map is left empty.
+	auto periodic_copies = in_place ? move(periodic) : periodic;
+	if (in_place) {
+		periodic.clear();
+	}
+	length2map_culled.clear();
+
+	// Every length has a level, made from the longest down, as when shorter copies were looked up in them.
+	bool nested = !periodic_copies.empty();
+	for (auto seq_length = statistics.max_repeat_length; seq_length > config_min_repeat_length; --seq_length) {
+		auto level = length2map.find(seq_length);
+		nested = (level != length2map.end() && !level->second.Empty()) || nested;
+		level_of(length2map_culled, seq_length, fullbuffer);
+	}
+	if (nested) {
+		level_of(length2map_culled, config_min_repeat_length, fullbuffer);
+	}
+
+	// The longest copy at every start, as start, length; sorted now and then to keep it short.
+	vector<pair<streamsize, streamsize>> longest;
+	auto sort_longest = [&longest]() {
+		sort(longest.begin(), longest.end(), [](const pair<streamsize, streamsize>& a, const pair<streamsize, streamsize>& b) {
+			return a.first < b.first || (a.first == b.first && a.second > b.second);
+		});
+		longest.erase(unique(longest.begin(), longest.end(),
+			[](const pair<streamsize, streamsize>& a, const pair<streamsize, streamsize>& b) { return a.first == b.first; }),
+			longest.end());
+	};
+	size_t sorted_size = 0;
+	progress.Start(Phase::culling, 2 * length2map.size());
+	for (auto const& [seq_length, level] : length2map) {
+		progress.Advance();
+		progress.ThrowIfCancelled();
+		for (auto const& [seq, positions] : level) {
+			for (auto seq_start : positions) {
+				longest.emplace_back(seq_start, seq_length);
+			}
+		}
+		if (longest.size() > 2 * sorted_size + (1 << 20)) {
+			sort_longest();
+			sorted_size = longest.size();
+		}
+	}
+	for (auto const& copies : periodic_copies) {
+		for (streamsize j = 0; j < copies.count; ++j) {
+			auto start = copies.first + j * copies.period;
+			auto length = min(copies.longest, copies.end - start);
+			if (length >= copies.shortest) {
+				longest.emplace_back(start, length);
+			}
+		}
+	}
+	sort_longest();
+
+	vector<pair<streamsize, streamsize>> left;
+	streamsize max_end = 0;
+	for (auto const& [start, length] : longest) {
+		if (start + length > max_end) {
+			left.emplace_back(start, length);
+			max_end = start + length;
+		}
+	}
+	longest = vector<pair<streamsize, streamsize>>();
+
+	// The copies left, family by family; in place, a level goes as soon as it is culled.
+	vector<bool> in_levels(left.size(), false); // the others are periodic copies
+	for (auto& [seq_length, level] : length2map) {
+		progress.Advance();
+		progress.ThrowIfCancelled();
+		auto& culled = level_of(length2map_culled, seq_length, fullbuffer);
+		for (auto const& [seq, positions] : level) {
+			PositionList kept;
+			for (auto start : positions) {
+				auto found = lower_bound(left.begin(), left.end(), make_pair(start, (streamsize)0),
+					[](const pair<streamsize, streamsize>& a, const pair<streamsize, streamsize>& b) { return a.first < b.first; });
+				if (found != left.end() && found->first == start && found->second == seq_length) {
+					kept.Add(start);
+					in_levels[(size_t)(found - left.begin())] = true;
+				}
+			}
+			if (!kept.Empty()) {
+				culled[seq] = move(kept);
+			}
+		}
+		if (in_place) {
+			level = FamilyLevel(fullbuffer);
+		}
+	}
+	if (in_place) {
+		length2map.clear();
+	}
+
+	// The periodic copies left.
+	for (size_t i = 0; i < left.size(); ++i) {
+		if (!in_levels[i]) {
+			auto [start, length] = left[i];
+			level_of(length2map_culled, length, fullbuffer)[fullbuffer.substr(start, length)].Add(start);
+		}
+	}
+} // Cull()
+
+/*
+* Consider all sequences long enough that also appear enough times.
+* Calculate the footprints and density.
+*/
+void RepeatFinder::CalculateFootprints(const FamilyLevels& levels)
+{
+	footprints.assign(fullbuffer.size(), false);
+
+	log << endl << "Using the " << (&levels == &length2map_culled ? "culled" : "unculled") << " data, calculating the footprints... ";
+
+	progress.Start(Phase::footprints, levels.size());
+	for (auto const& [seq_length, level] : levels) {
+		progress.Advance();
+		progress.ThrowIfCancelled();
+		for (auto const& [seq, positions] : level) {
+			for (auto pos : positions) {
+				fill(footprints.begin() + pos, footprints.begin() + pos + seq_length, true);
+			}
+		}
+	}
+
+	// Periodic copies overlap: together they cover from the first one to where the last one ends at its longest.
+	unordered_map<streamsize, streamsize> periodic_counts;
+	if (&levels == &length2map) {
+		for (auto const& copies : periodic) {
+			auto last = copies.first + (copies.CountAt(copies.shortest) - 1) * copies.period;
+			auto end = min(last + copies.longest, copies.end);
+			fill(footprints.begin() + copies.first, footprints.begin() + end, true);
+		}
+		periodic_counts = PeriodicCounts();
+	}
+
+	CountFootprints();
+
+	// How many sequences are left after culling?
+	long seq_total_count = 0;
+	log << endl << "Sequences " << (&levels == &length2map_culled ? "left after culling" : "found") << ", per sequence length:" << endl;
+	for (auto const& [seq_length, level] : levels) {
+		auto count = copy_count_of(level) + periodic_counts[seq_length];
+		if (count < 1) {
+			continue;
+		}
+		log << seq_length << ":\t" << count << endl;
+		seq_total_count += count;
+	}
+	log << "Total:\t" << seq_total_count << endl;
+} // CalculateFootprints()
+
+/*
+* The density, from the footprints; of the target regions, if any.
+*/
+void RepeatFinder::CountFootprints()
+{
+	// With target regions, only the footprints in them.
+	if (regions) {
+		streamsize outside = 0;
+		for (auto const& region : regions->Regions()) {
+			fill(footprints.begin() + outside, footprints.begin() + region.start, false);
+			outside = region.end;
+		}
+		fill(footprints.begin() + outside, footprints.end(), false);
+	}
+
+	log << "Calculating the density... ";
+
+	size_t footprints_count = 0;
+	for (auto f : footprints) {
+		if (f) {
+			++footprints_count;
+		}
+	}
+	statistics.footprints_count = footprints_count;
+
+	log << endl << footprints_count << " combined footprints count; that is, "
+		<< statistics.density_percent() << "% density."
+		<< " (" << statistics.subdensity_percent() << "% subdensity.)"
+		<< endl;
+} // CountFootprints()
+
+/*
+* The copies of periodic, per length.
+*/
+unordered_map<streamsize, streamsize> RepeatFinder::PeriodicCounts() const
+{
+	unordered_map<streamsize, streamsize> counts;
+	for (auto const& copies : periodic) {
+		for (auto seq_length = copies.shortest; seq_length <= copies.longest; ++seq_length) {
+			counts[seq_length] += copies.CountAt(seq_length);
+		}
+	}
+	return counts;
+} // PeriodicCounts()
+
+/*
+* Both strands: report every family with the letters of its leftmost copy,
+* whichever strand that is. The choice is made before culling,
+* so that a family keeps its letters after culling.
+*/
+void RepeatFinder::OrientFamilies()
+{
+	for (auto const& [len, level] : length2map) {
+		// The first phase registers a sequence at the position right before it.
+		auto shift = len == config_min_repeat_length ? 1 : 0;
+		for (auto const& [seq, positions] : level) {
+			auto start = positions.Front();
+			auto found = seq2offset.Find(seq);
+			if (found == nullptr) {
+				seq2offset[seq] = start + shift;
+			}
+			else if (start + shift < *found) {
+				*found = start + shift;
+			}
+		}
+	}
+} // OrientFamilies()
+
+/*
+* Pass the families of every level on, with the periodic copies of their letters;
+* with target regions, those with a copy in them.
+*/
+void RepeatFinder::EmitFamilies(const FamilyLevels& levels,
+	const function<void(const RepeatFamily&)>& callback)
+{
+	auto any_in_regions = [this](const PositionList& positions) {
+		for (auto p : positions) {
+			if (regions->Contains(p)) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// A family of length len to the callback, with the letters and strands of its copies.
+	RepeatFamily family;
+	auto emit = [&](string_view seq, streamsize len, const PositionList& positions) {
+		if (regions && !any_in_regions(positions)) {
+			return; // found around the regions, see FindSeeds()
+		}
+		family.sequence = string(seq);
+		family.positions = positions;
+		// The first phase registers a sequence at the position right before it.
+		family.sequence_offset = family.positions.Front() + (len == config_min_repeat_length ? 1 : 0);
+		auto found = seq2offset.Find(family.sequence);
+		if (found != nullptr) {
+			family.sequence_offset = *found;
+		}
+		family.reverse.clear();
+		if (config.please_search_both_strands) {
+			// Copies are on the reverse strand when their letters differ from the family's.
+			auto shift = len == config_min_repeat_length ? 1 : 0;
+			family.sequence = string(fullbuffer.substr(family.sequence_offset, len));
+			for (auto p : family.positions) {
+				family.reverse.push_back(fullbuffer.substr(p + shift, len) != family.sequence);
+			}
+		}
+		callback(family);
+	};
+
+	for (auto const& [len, level] : levels) {
+		progress.ThrowIfCancelled();
+
+		// The periodic copies, spelled out one level at a time, go with the families of their letters.
+		vector<pair<streamsize, string_view>> spelled; // start, sequence
+		if (&levels == &length2map) {
+			for (auto const& copies : periodic) {
+				if (copies.longest < len) {
+					break;
+				}
+				for (streamsize j = 0; j < copies.CountAt(len); ++j) {
+					auto start = copies.first + j * copies.period;
+					spelled.emplace_back(start, fullbuffer.substr(start, len));
+				}
+			}
+		}
+		if (spelled.empty()) {
+			for (auto const& [seq, positions] : level) {
+				emit(seq, len, positions);
+			}
+			continue;
+		}
+
+		// In order, so that the position lists are built in order.
+		sort(spelled.begin(), spelled.end());
+		SequenceTable<PositionList> seq2pos(fullbuffer);
+		for (auto const& [start, seq] : spelled) {
+			seq2pos[seq].Add(start);
+		}
+		for (auto const& [seq, positions] : level) {
+			seq2pos[seq].Merge(positions);
+		}
+		for (auto const& [seq, positions] : seq2pos) {
+			emit(seq, len, positions);
+		}
+	}
+} // EmitFamilies()
+
+void RepeatFinder::EmitIslands()
+{
+	Island island;
+	bool in_island = false;
+	for (streamsize fx = 0; fx < (streamsize)fullbuffer.size(); fx++)
+	{
+		if (footprints[fx]) {
+			if (in_island) continue;
+			in_island = true;
+			island.start = fx;
+			continue;
+		}
+		// !footprints[fx]
+		if (in_island) {
+			in_island = false;
+			island.end = fx - 1;
+			on_island(island);
+		}
+	}
+} // EmitIslands()
@@ -0,0 +1,227 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <iostream>
+#include <memory_resource>
+#include <algorithm>
+
+#include "Config.h"
+#include "NBlockIndex.h"
+#include "PackedFasta.h"
+#include "PackedSequence.h"
+#include "PositionList.h"
+#include "Progress.h"
+#include "SequenceTable.h"
+#include "TargetRegions.h"
+
+using namespace std;
+
+/*
+* A repeat family: a sequence and all the positions where it starts.
+* With both strands searched, a copy may be the reverse complement of the sequence.
+*/
+struct RepeatFamily
+{
+	string sequence;
+	PositionList positions; // in increasing order
+	vector<bool> reverse; // per position, true for a reverse complement copy; empty for the forward strand only
+	streamsize sequence_offset; // where the letters of sequence are found in the input
+};
+
+/*
+* The families of one length, as sequence -> the positions of its copies, and the levels of all the lengths.
+* A family is one entry, its copies a PositionList: 32-bit offsets or a few bytes apiece,
+* rather than an entry and a sequence per copy. The keys are kept in the input where they can be,
+* see level_of(). The levels are allocated from the memory resource given to the RepeatFinder,
+* e.g. an Arena (see Arena.h).
+*/
+using FamilyLevel = SequenceTable<PositionList>;
+using FamilyLevels = pmr::unordered_map<streamsize, FamilyLevel>;
+
+// The level of seq_length, made if there is none yet, with its keys kept in sequence (the input).
+inline FamilyLevel& level_of(FamilyLevels& levels, streamsize seq_length, string_view sequence)
+{
+	return levels.try_emplace(seq_length, sequence).first->second;
+}
+
+/*
+* The copies of a family inside a periodic run, e.g. a homopolymer or a tandem array,
+* kept as one record rather than one entry per copy and per length, see RepeatFinder::ExtendFamilies():
+* at every length from shortest to longest, the copies first + j * period, j < count,
+* whose letters end by the end of the run.
+*/
+struct PeriodicCopies
+{
+	streamsize first;
+	streamsize period;
+	streamsize count;
+	streamsize end; // of the run, exclusive
+	streamsize shortest;
+	streamsize longest;
+
+	streamsize CountAt(streamsize seq_length) const {
+		if (seq_length < shortest || seq_length > longest || end - seq_length < first) {
+			return 0;
+		}
+		return min(count, (end - seq_length - first) / period + 1);
+	}
+};
+
+/*
+* A footprint island: a maximal run of positions covered by repeats.
+* Both ends are inclusive and not shifted by config.shift_coordinates.
+*/
+struct Island
+{
+	streamsize start, end;
+};
+
+/*
+* The stages after the filters that a run needs, from what its callers take, see RepeatFinder::Plan().
+*/
+struct RunPlan
+{
+	bool orient = true; // both strands: the letters to report every family with
+	bool cull = true; // length2map_culled
+	bool keep_families = true; // length2map after culling; else it is culled in place
+	bool footprints = true; // footprints, islands and their statistics
+};
+
+/*
+* What is known about the sequence once all the stages are done.
+*/
+struct RepeatStatistics
+{
+	size_t sequence_size = 0; // letters, without the control characters
+	size_t meaningful_letters = 0; // letters from config.letters
+	size_t footprints_count = 0; // letters covered by the culled repeats
+	streamsize windows = 0; // sequences of the minimum length looked at in the first phase
+	streamsize max_repeat_length = 0;
+
+	double density_percent() const {
+		return 100.0 * footprints_count / sequence_size;
+	}
+
+	double subdensity_percent() const {
+		return 100.0 * footprints_count / meaningful_letters;
+	}
+};
+
+/*
+* Finds repeats of at least min_repeat_length letters with at least copy_number copies
+* in a sequence already held in memory, see T24_HowTo.txt for the algorithm.
+* Process type selects the fpt or crd parameters from config.
+*
+* Results are passed to the callbacks as soon as the stage producing them is done:
+*	- on_family, for every family that survived the extension and the filters;
+*	- on_culled_family, for every family left after culling;
+*	- on_island, for every footprint island, in order of positions.
+* Callbacks that are not set cost nothing: the stages only they need are skipped, see Plan();
+* with on_island alone, Run() finds the footprints without the families, see FindFootprints().
+* Families() after the run needs keep_families; without it, the copies inside periodic runs
+* are kept as PeriodicCopies and only spelled out for the callbacks.
+* With config.max_mismatches > 0, the copies of a repeat may differ from it
+* in up to that many letters, see FindApproximate().
+* With config.please_search_both_strands, reverse complement copies count as copies,
+* see Canonical().
+* With regions, the sequences of the minimum length are only taken from around the regions
+* and counted over the whole sequence, see FindSeeds(); the footprints in the regions
+* are those of the whole run.
+* Progress is logged to the stream given to the constructor, and published in progress
+* for a ProgressReporter; progress.Cancel() stops the run with a Cancelled exception.
+*/
+class RepeatFinder
+{
+public:
+	function<void(const RepeatFamily&)> on_family;
+	function<void(const RepeatFamily&)> on_culled_family;
+	function<void(const Island&)> on_island;
+
+	bool keep_families = false; // Families() is still read after FinishFamilies(), e.g. for a state file
+
+	// The .t24p file the sequence was reloaded from, if any; its planes are used
+	// instead of packing the sequence again when they were packed with the same letters.
+	const PackedFasta* packed_input = nullptr;
+
+	// Only the families with a copy in these regions, and the footprints in them, see TargetRegions.h.
+	const TargetRegions* regions = nullptr;
+
+	Progress progress;
+
+	// The families are kept in memory, e.g. an Arena released after every input file.
+	RepeatFinder(Config config, Process_Type pt, ostream& log = cout,
+		pmr::memory_resource* memory = pmr::get_default_resource());
+
+	// The sequence must not contain control characters
+	// and must stay alive until Run() returns.
+	void Run(string_view sequence);
+
+	// Run() in steps, for sharded runs (see ShardFile.h): FindFamilies() in every shard,
+	// then SetFamilies() with the families of all the shards and FinishFamilies().
+	void FindFamilies(string_view sequence);
+	void SetFamilies(string_view sequence,
+		FamilyLevels&& families, const RepeatStatistics& found);
+	void FinishFamilies();
+
+	// For incremental runs (see IncrementalState.h): after SetFamilies(),
+	// extend the families of the minimum length given by their positions, before FinishFamilies().
+	void ExtendSeeds(SequenceTable<PositionList>&& seeds);
+
+	const RepeatStatistics& Statistics() const {
+		return statistics;
+	}
+
+	// Map: sequence length -> families of that length, before and after culling;
+	// either is empty when the run did not need it, see Plan().
+	const FamilyLevels& Families() const {
+		return length2map;
+	}
+	const FamilyLevels& CulledFamilies() const {
+		return length2map_culled;
+	}
+
+private:
+	Config config;
+	Process_Type pt;
+	ostream& log;
+
+	streamsize config_min_repeat_length;
+	unsigned int config_copy_number;
+
+	string_view fullbuffer;
+	NBlockIndex nblocks; // of fullbuffer
+	TargetRegions reach; // regions, from where the windows over their letters are registered
+	RepeatStatistics statistics;
+
+	SequenceTable<PositionList> seq2positions; // keys in fullbuffer where they can be
+	FamilyLevels length2map;
+	FamilyLevels length2map_culled;
+	vector<PeriodicCopies> periodic; // of length2map, not in it; by longest, decreasing
+	vector<bool> footprints;
+	SequenceTable<streamsize> seq2offset; // approximate repeats, both strands: where each one is found
+	char complement_table[256]; // letter -> complementary letter
+
+	string Canonical(string seq) const;
+	void OrientFamilies();
+
+	void FindSeeds();
+	void FindApproximate();
+	void FindVariableCenters();
+	void Extend();
+	void ExtendFamilies();
+	void FilterFamilies();
+	bool FootprintsOnly();
+	void FindFootprints(string_view sequence);
+	RunPlan Plan();
+	void Cull(bool in_place);
+	void CalculateFootprints(const FamilyLevels& levels);
+	void CountFootprints();
+	unordered_map<streamsize, streamsize> PeriodicCounts() const;
+
+	void EmitFamilies(const FamilyLevels& levels,
+		const function<void(const RepeatFamily&)>& callback);
+	void EmitIslands();
+};
@@ -0,0 +1,60 @@
+#include "RepeatOutputs.h"
+
+using namespace std;
+
+RepeatOutputs::RepeatOutputs(Config config, Process_Type pt, const FastaFile& input)
+{
+	if (config.please_create_text_files) {
+		text = make_unique<TextOutput>(config, pt, input.filename, input.sequence);
+	}
+	if (config.please_create_binary_file) {
+		binary = make_unique<ResultFileWriter>(config, pt, input.filename, input.sequence);
+	}
+	if (pt == Process_Type::fpt && !config.density_bins.empty()) {
+		tracks = make_unique<DensityTracks>(config, input);
+	}
+}
+
+void RepeatOutputs::Connect(RepeatFinder& finder)
+{
+	if (binary || (text && text->NeedsFamilies())) {
+		finder.on_family = [this](const RepeatFamily& family) {
+			if (text) text->AddFamily(family);
+			if (binary) binary->AddFamily(family);
+		};
+	}
+	if ((binary && binary->NeedsCulledFamilies()) || (text && text->NeedsCulledFamilies())) {
+		finder.on_culled_family = [this](const RepeatFamily& family) {
+			if (text) text->AddCulledFamily(family);
+			if (binary) binary->AddCulledFamily(family);
+		};
+	}
+	if (binary || tracks || (text && text->NeedsIslands())) {
+		finder.on_island = [this](const Island& island) {
+			if (text) text->AddIsland(island);
+			if (binary) binary->AddIsland(island);
+			if (tracks) tracks->AddIsland(island);
+		};
+	}
+}
+
+void RepeatOutputs::Finish(const RepeatStatistics& statistics)
+{
+	if (text) {
+		text->Finish(statistics);
+	}
+	if (binary) {
+		binary->Finish(statistics);
+	}
+	if (tracks) {
+		tracks->Finish();
+	}
+}
+
+void RepeatOutputs::Discard()
+{
+	// The binary file and the tracks are only written by Finish().
+	if (text) {
+		text->Discard();
+	}
+}
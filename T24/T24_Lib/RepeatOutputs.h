@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+
+#include "Config.h"
+#include "FastaFile.h"
+#include "RepeatFinder.h"
+#include "TextOutput.h"
+#include "ResultFile.h"
+#include "DensityTracks.h"
+
+using namespace std;
+
+/*
+* The output files requested by config (text, binary or both, and the density tracks)
+* for one input file and one process type.
+* Connect() sets the callbacks of a RepeatFinder, so that each file is written
+* as soon as the finder has the data for it, and only the ones the files need,
+* so that the finder skips the rest (see RepeatFinder::Plan()); Finish() completes them,
+* Discard() removes them if the run is cancelled.
+*/
+class RepeatOutputs
+{
+public:
+	RepeatOutputs(Config config, Process_Type pt, const FastaFile& input);
+
+	void Connect(RepeatFinder& finder);
+	void Finish(const RepeatStatistics& statistics);
+	void Discard();
+
+private:
+	unique_ptr<TextOutput> text;
+	unique_ptr<ResultFileWriter> binary;
+	unique_ptr<DensityTracks> tracks; // footprints only
+};
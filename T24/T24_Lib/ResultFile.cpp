@@ -0,0 +1,333 @@
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+#include "ResultFile.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+static const char result_magic[4] = { 'T', '2', '4', 'R' };
+static const uint32_t result_version = 2; // 2: interval strands
+
+/*
+* Writer.
+*/
+
+ResultFileWriter::ResultFileWriter(Config config, Process_Type pt, string filename, string_view sequence)
+	: config(config), pt(pt), filename(filename), sequence(sequence)
+{
+}
+
+string ResultFileWriter::FileName(Config config, Process_Type pt, string filename)
+{
+	string prefix = pt == Process_Type::fpt ? "fpt_" : "crd_";
+	auto output_filename = prefix + output_basename(config, filename) + ".t24r";
+	return (fs::path(config.output_folder_name) /= output_filename).string();
+}
+
+void ResultFileWriter::AddFamily(const RepeatFamily& family)
+{
+	auto id = (uint32_t)family_offset.size();
+	seq2family[family.sequence] = id;
+	family_offset.push_back(family.sequence_offset);
+	family_length.push_back((uint32_t)family.sequence.length());
+	family_count.push_back((uint32_t)family.positions.Size());
+
+	if (!config.please_cull_crd) {
+		AddIntervals(family);
+	}
+}
+
+void ResultFileWriter::AddCulledFamily(const RepeatFamily& family)
+{
+	if (config.please_cull_crd) {
+		AddIntervals(family);
+	}
+}
+
+void ResultFileWriter::AddIntervals(const RepeatFamily& family)
+{
+	auto found = seq2family.find(family.sequence);
+	if (found == seq2family.end()) {
+		Error().Fatal("***Internal error: culled family without a family: " + family.sequence);
+	}
+	size_t i = 0;
+	for (auto position : family.positions) {
+		uint8_t strand = i < family.reverse.size() && family.reverse[i] ? 1 : 0;
+		intervals.push_back({ (uint64_t)position, found->second, (uint32_t)family.sequence.length(), strand });
+		++i;
+	}
+}
+
+void ResultFileWriter::AddIsland(const Island& island)
+{
+	island_start.push_back(island.start);
+	island_end.push_back(island.end);
+}
+
+void ResultFileWriter::Finish(const RepeatStatistics& statistics)
+{
+	auto output_filename = FileName(config, pt, filename);
+	std::cout << "Generating " << output_filename << "...";
+
+	ensure_output_folder(config);
+
+	stable_sort(intervals.begin(), intervals.end(),
+		[](const Interval& a, const Interval& b) { return a.start < b.start; });
+
+	// Columns.
+	vector<uint32_t> interval_family(intervals.size());
+	vector<uint64_t> interval_start(intervals.size());
+	vector<uint32_t> interval_length(intervals.size());
+	vector<uint8_t> interval_strand(intervals.size());
+	for (size_t i = 0; i < intervals.size(); ++i) {
+		interval_family[i] = intervals[i].family;
+		interval_start[i] = intervals[i].start;
+		interval_length[i] = intervals[i].length;
+		interval_strand[i] = intervals[i].strand;
+	}
+	intervals.clear();
+	intervals.shrink_to_fit();
+
+	// Region index.
+	uint64_t region_count = (sequence.size() >> ResultFile::region_bits) + 1;
+	vector<uint64_t> regions(region_count + 1);
+	size_t interval_x = 0;
+	for (uint64_t r = 0; r < region_count; ++r) {
+		while (interval_x < interval_start.size() && interval_start[interval_x] < (r << ResultFile::region_bits)) {
+			++interval_x;
+		}
+		regions[r] = interval_x;
+	}
+	regions[region_count] = interval_start.size();
+
+	string names = filename + '\0' + config.config_map[config.label_input_filename_prefix] + '\0';
+
+	ResultHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, result_magic, sizeof(header.magic));
+	header.version = result_version;
+	header.process_type = (uint32_t)pt;
+	header.flags = (config.please_cull_crd ? (uint32_t)result_intervals_culled : 0u)
+		| (config.please_create_masked_file ? (uint32_t)result_masked_requested : 0u);
+	header.min_repeat_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	header.copy_number = pt == Process_Type::fpt ? config.fpt_copy_number : config.crd_copy_number;
+	header.shift_coordinates = config.shift_coordinates;
+	header.absolute_origin = config.absolute_origin;
+	header.sequence_size = statistics.sequence_size;
+	header.meaningful_letters = statistics.meaningful_letters;
+	header.footprints_count = statistics.footprints_count;
+	header.windows = statistics.windows;
+	header.max_repeat_length = statistics.max_repeat_length;
+	header.family_count = family_offset.size();
+	header.interval_count = interval_start.size();
+	header.island_count = island_start.size();
+	header.region_count = region_count;
+	header.region_bits = ResultFile::region_bits;
+	header.masking_character = config.masking_character;
+
+	ofstream os(output_filename, ios::binary | ios::trunc);
+	if (!os) {
+		Error().Fatal("Cannot open for writing file: " + output_filename);
+	}
+	os.write((const char*)&header, sizeof(header));
+
+	auto write_section = [&](ResultSection section, const void* data, size_t size) {
+		static const char padding[8] = {};
+		auto offset = (uint64_t)os.tellp();
+		if (offset % 8 != 0) {
+			os.write(padding, 8 - offset % 8);
+			offset += 8 - offset % 8;
+		}
+		auto& entry = header.sections[(size_t)section];
+		entry.offset = offset;
+		entry.size = size;
+		entry.checksum = crc32(data, size);
+		os.write((const char*)data, size);
+	};
+	write_section(ResultSection::names, names.data(), names.size());
+	write_section(ResultSection::sequence, sequence.data(), sequence.size());
+	write_section(ResultSection::family_offset, family_offset.data(), family_offset.size() * sizeof(uint64_t));
+	write_section(ResultSection::family_length, family_length.data(), family_length.size() * sizeof(uint32_t));
+	write_section(ResultSection::family_count, family_count.data(), family_count.size() * sizeof(uint32_t));
+	write_section(ResultSection::interval_family, interval_family.data(), interval_family.size() * sizeof(uint32_t));
+	write_section(ResultSection::interval_start, interval_start.data(), interval_start.size() * sizeof(uint64_t));
+	write_section(ResultSection::interval_length, interval_length.data(), interval_length.size() * sizeof(uint32_t));
+	write_section(ResultSection::interval_strand, interval_strand.data(), interval_strand.size() * sizeof(uint8_t));
+	write_section(ResultSection::island_start, island_start.data(), island_start.size() * sizeof(uint64_t));
+	write_section(ResultSection::island_end, island_end.data(), island_end.size() * sizeof(uint64_t));
+	write_section(ResultSection::regions, regions.data(), regions.size() * sizeof(uint64_t));
+
+	header.header_checksum = crc32(&header, offsetof(ResultHeader, header_checksum));
+	os.seekp(0);
+	os.write((const char*)&header, sizeof(header));
+	os.close();
+	if (!os) {
+		Error().Fatal("Cannot write file: " + output_filename);
+	}
+
+	std::cout << endl;
+}
+
+/*
+* Reader.
+*/
+
+void ResultFile::Open(string filename)
+{
+	mapped.Open(filename);
+	header = (const ResultHeader*)mapped.Data();
+
+	if (mapped.Size() < sizeof(ResultHeader) || memcmp(header->magic, result_magic, sizeof(result_magic)) != 0) {
+		Error().Fatal("Not a binary result file: " + filename);
+	}
+	if (header->version != result_version) {
+		Error().Fatal("Unsupported binary result file version " + to_string(header->version) + ": " + filename);
+	}
+	if (header->header_checksum != crc32(header, offsetof(ResultHeader, header_checksum))) {
+		Error().Fatal("Header checksum mismatch: " + filename);
+	}
+
+	// Expected section sizes.
+	uint64_t expected[(size_t)ResultSection::total] = {};
+	expected[(size_t)ResultSection::sequence] = header->sequence_size;
+	expected[(size_t)ResultSection::family_offset] = header->family_count * sizeof(uint64_t);
+	expected[(size_t)ResultSection::family_length] = header->family_count * sizeof(uint32_t);
+	expected[(size_t)ResultSection::family_count] = header->family_count * sizeof(uint32_t);
+	expected[(size_t)ResultSection::interval_family] = header->interval_count * sizeof(uint32_t);
+	expected[(size_t)ResultSection::interval_start] = header->interval_count * sizeof(uint64_t);
+	expected[(size_t)ResultSection::interval_length] = header->interval_count * sizeof(uint32_t);
+	expected[(size_t)ResultSection::interval_strand] = header->interval_count * sizeof(uint8_t);
+	expected[(size_t)ResultSection::island_start] = header->island_count * sizeof(uint64_t);
+	expected[(size_t)ResultSection::island_end] = header->island_count * sizeof(uint64_t);
+	expected[(size_t)ResultSection::regions] = (header->region_count + 1) * sizeof(uint64_t);
+
+	for (size_t s = 0; s < (size_t)ResultSection::total; ++s) {
+		auto& entry = header->sections[s];
+		if (entry.offset % 8 != 0 || entry.offset > mapped.Size() || entry.size > mapped.Size() - entry.offset) {
+			Error().Fatal("Section " + to_string(s) + " out of bounds: " + filename);
+		}
+		if (s != (size_t)ResultSection::names && entry.size != expected[s]) {
+			Error().Fatal("Section " + to_string(s) + " has a wrong size: " + filename);
+		}
+		if (entry.checksum != crc32(mapped.Data() + entry.offset, (size_t)entry.size)) {
+			Error().Fatal("Section " + to_string(s) + " checksum mismatch: " + filename);
+		}
+	}
+}
+
+string ResultFile::Filename() const
+{
+	return string(Column<char>(ResultSection::names));
+}
+
+string ResultFile::InputPrefix() const
+{
+	auto names = Column<char>(ResultSection::names);
+	return string(names + strlen(names) + 1);
+}
+
+pair<uint64_t, uint64_t> ResultFile::IntervalRange(uint64_t from, uint64_t to) const
+{
+	auto regions = Column<uint64_t>(ResultSection::regions);
+	auto starts = IntervalStart();
+
+	auto first_at = [&](uint64_t position) {
+		auto r = min(position >> header->region_bits, header->region_count);
+		auto r_next = min(r + 1, header->region_count);
+		return (uint64_t)(lower_bound(starts + regions[r], starts + regions[r_next], position) - starts);
+	};
+
+	if (to <= from) {
+		return { 0, 0 };
+	}
+	return { first_at(from), first_at(to) };
+}
+
+Config ResultFile::OutputConfig(Config config) const
+{
+	config.shift_coordinates = header->shift_coordinates;
+	config.absolute_origin = header->absolute_origin;
+	config.masking_character = header->masking_character;
+	config.please_cull_crd = (header->flags & result_intervals_culled) != 0;
+	config.please_create_masked_file = (header->flags & result_masked_requested) != 0;
+	config.config_map[config.label_input_filename_prefix] = InputPrefix();
+	if (ProcessType() == Process_Type::fpt) {
+		config.fpt_min_repeat_length = header->min_repeat_length;
+		config.fpt_copy_number = header->copy_number;
+	}
+	else {
+		config.crd_min_repeat_length = header->min_repeat_length;
+		config.crd_copy_number = header->copy_number;
+	}
+	return config;
+}
+
+RepeatStatistics ResultFile::Statistics() const
+{
+	RepeatStatistics statistics;
+	statistics.sequence_size = (size_t)header->sequence_size;
+	statistics.meaningful_letters = (size_t)header->meaningful_letters;
+	statistics.footprints_count = (size_t)header->footprints_count;
+	statistics.windows = header->windows;
+	statistics.max_repeat_length = header->max_repeat_length;
+	return statistics;
+}
+
+void ResultFile::WriteText(Config config) const
+{
+	config = OutputConfig(config);
+	TextOutput text(config, ProcessType(), Filename(), Sequence());
+
+	if (text.NeedsFamilies()) {
+		// Intervals of each family, in the order of their starts.
+		vector<uint64_t> family_first(header->family_count + 1, 0);
+		auto interval_family = IntervalFamily();
+		for (uint64_t i = 0; i < header->interval_count; ++i) {
+			++family_first[interval_family[i] + 1];
+		}
+		for (uint64_t f = 0; f < header->family_count; ++f) {
+			family_first[f + 1] += family_first[f];
+		}
+		vector<uint64_t> family_intervals(header->interval_count);
+		vector<uint64_t> family_fill(family_first.begin(), family_first.end() - 1);
+		for (uint64_t i = 0; i < header->interval_count; ++i) {
+			family_intervals[family_fill[interval_family[i]]++] = i;
+		}
+
+		auto starts = IntervalStart();
+		auto strands = IntervalStrand();
+		auto family_count = FamilyCount();
+		RepeatFamily family;
+		for (uint64_t f = 0; f < header->family_count; ++f) {
+			family.sequence = string(FamilySequence(f));
+			family.sequence_offset = FamilyOffset()[f];
+			family.positions.Clear();
+			family.reverse.clear();
+			for (auto x = family_first[f]; x < family_first[f + 1]; ++x) {
+				family.positions.Add((streamsize)starts[family_intervals[x]]);
+				family.reverse.push_back(strands[family_intervals[x]] != 0);
+			}
+
+			if (config.please_cull_crd) {
+				text.AddCopyNumber(family.sequence, family_count[f]);
+				text.AddCulledFamily(family);
+			}
+			else {
+				text.AddFamily(family);
+			}
+		}
+	}
+
+	auto island_start = IslandStart();
+	auto island_end = IslandEnd();
+	for (uint64_t i = 0; i < header->island_count; ++i) {
+		text.AddIsland({ (streamsize)island_start[i], (streamsize)island_end[i] });
+	}
+
+	text.Finish(Statistics());
+}
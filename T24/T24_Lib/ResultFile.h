@@ -0,0 +1,181 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Config.h"
+#include "Crc32.h"
+#include "MappedFile.h"
+#include "RepeatFinder.h"
+#include "TextOutput.h"
+
+using namespace std;
+
+/*
+* Binary result file (.t24r), an alternative to the text output files.
+* All numbers are little endian, every section starts at a multiple of 8 bytes.
+*
+*	header			ResultHeader, with the section table
+*	names			filename '\0' input filename prefix '\0'
+*	sequence		the input letters, families and the masked file refer to them
+*	families		columns: offset into sequence (u64), length (u32), count before culling (u32)
+*	intervals		columns: family (u32), start (u64), length (u32), strand (u8, 1 for reverse complement),
+*					sorted by start; culled or not, as requested by cull_crd
+*	islands			columns: start (u64), end (u64), inclusive, not shifted
+*	regions			for every 2^region_bits positions, the first interval starting there (u64),
+*					plus the total number of intervals
+*
+* Every section has a CRC-32 in the section table; the header has its own one.
+*/
+enum class ResultSection : uint32_t {
+	names,
+	sequence,
+	family_offset, family_length, family_count,
+	interval_family, interval_start, interval_length, interval_strand,
+	island_start, island_end,
+	regions,
+	total // not a section
+};
+
+struct ResultSectionEntry
+{
+	uint64_t offset; // from the beginning of the file
+	uint64_t size; // in bytes
+	uint32_t checksum;
+	uint32_t reserved;
+};
+
+struct ResultHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t process_type; // Process_Type
+	uint32_t flags; // ResultFlags
+	uint64_t min_repeat_length;
+	uint32_t copy_number;
+	int32_t shift_coordinates;
+	int64_t absolute_origin;
+	uint64_t sequence_size;
+	uint64_t meaningful_letters;
+	uint64_t footprints_count;
+	uint64_t windows;
+	uint64_t max_repeat_length;
+	uint64_t family_count;
+	uint64_t interval_count;
+	uint64_t island_count;
+	uint64_t region_count;
+	uint32_t region_bits;
+	char masking_character;
+	char reserved[3];
+	ResultSectionEntry sections[(size_t)ResultSection::total];
+	uint32_t header_checksum; // of all the bytes above
+	uint32_t reserved_end;
+};
+
+enum ResultFlags : uint32_t {
+	result_intervals_culled = 1,
+	result_masked_requested = 2,
+};
+
+/*
+* Collects the results of one RepeatFinder run and writes them into a .t24r file.
+*/
+class ResultFileWriter
+{
+public:
+	ResultFileWriter(Config config, Process_Type pt, string filename, string_view sequence);
+
+	bool NeedsCulledFamilies() const {
+		return config.please_cull_crd;
+	}
+
+	void AddFamily(const RepeatFamily& family); // before culling
+	void AddCulledFamily(const RepeatFamily& family);
+	void AddIsland(const Island& island);
+	void Finish(const RepeatStatistics& statistics);
+
+	static string FileName(Config config, Process_Type pt, string filename);
+
+private:
+	Config config;
+	Process_Type pt;
+	string filename;
+	string_view sequence;
+
+	unordered_map<string, uint32_t> seq2family;
+	vector<uint64_t> family_offset;
+	vector<uint32_t> family_length;
+	vector<uint32_t> family_count;
+
+	struct Interval
+	{
+		uint64_t start;
+		uint32_t family;
+		uint32_t length;
+		uint8_t strand;
+	};
+	vector<Interval> intervals;
+
+	vector<uint64_t> island_start;
+	vector<uint64_t> island_end;
+
+	void AddIntervals(const RepeatFamily& family);
+};
+
+class ResultFile
+{
+public:
+	static const uint32_t region_bits = 16;
+
+	// Map the file and check the header and all the checksums; fatal on any mismatch.
+	void Open(string filename);
+
+	const ResultHeader& Header() const {
+		return *header;
+	}
+
+	string Filename() const;
+	string InputPrefix() const;
+	string_view Sequence() const {
+		return string_view(Column<char>(ResultSection::sequence), (size_t)header->sequence_size);
+	}
+
+	const uint64_t* FamilyOffset() const { return Column<uint64_t>(ResultSection::family_offset); }
+	const uint32_t* FamilyLength() const { return Column<uint32_t>(ResultSection::family_length); }
+	const uint32_t* FamilyCount() const { return Column<uint32_t>(ResultSection::family_count); }
+	string_view FamilySequence(uint64_t family) const {
+		return Sequence().substr((size_t)FamilyOffset()[family], FamilyLength()[family]);
+	}
+
+	const uint32_t* IntervalFamily() const { return Column<uint32_t>(ResultSection::interval_family); }
+	const uint64_t* IntervalStart() const { return Column<uint64_t>(ResultSection::interval_start); }
+	const uint32_t* IntervalLength() const { return Column<uint32_t>(ResultSection::interval_length); }
+	const uint8_t* IntervalStrand() const { return Column<uint8_t>(ResultSection::interval_strand); }
+
+	const uint64_t* IslandStart() const { return Column<uint64_t>(ResultSection::island_start); }
+	const uint64_t* IslandEnd() const { return Column<uint64_t>(ResultSection::island_end); }
+
+	// Indices [first, last) of the intervals starting at positions [from, to).
+	pair<uint64_t, uint64_t> IntervalRange(uint64_t from, uint64_t to) const;
+
+	// The configuration the file was written with, as far as the text outputs need it.
+	Config OutputConfig(Config config = Config()) const;
+	Process_Type ProcessType() const {
+		return (Process_Type)header->process_type;
+	}
+	RepeatStatistics Statistics() const;
+
+	// Regenerate the text output files in config's output folder.
+	void WriteText(Config config = Config()) const;
+
+private:
+	MappedFile mapped;
+	const ResultHeader* header = nullptr;
+
+	template <class T>
+	const T* Column(ResultSection section) const {
+		return (const T*)(mapped.Data() + header->sections[(size_t)section].offset);
+	}
+};
@@ -0,0 +1,266 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+/*
+* Polynomial hash of the last length letters of a sequence, updated in constant time per letter:
+* the hash of every window of the first phase without hashing the window.
+* Gives the same as SequenceTable's Hash() of the window.
+*/
+class RollingHash
+{
+public:
+	static const uint64_t base = 0x100000001B3ULL;
+
+	explicit RollingHash(size_t length)
+	{
+		for (size_t i = 0; i < length; ++i) {
+			power *= base;
+		}
+	}
+
+	void Reset() {
+		hash = 0;
+	}
+	// Add a letter, while there are fewer than length of them.
+	void Add(char in) {
+		hash = hash * base + (unsigned char)in;
+	}
+	// Add a letter and drop the one that is length letters back.
+	void Roll(char in, char out) {
+		hash = hash * base + (unsigned char)in - (unsigned char)out * power;
+	}
+	uint64_t Hash() const {
+		return hash;
+	}
+
+private:
+	uint64_t power = 1; // base to the length
+	uint64_t hash = 0;
+};
+
+/*
+* Hash table from sequences to values, for the many short keys of the first phase,
+* the extension and the output.
+* Open addressing with Robin Hood probing over 8-byte slots (part of the hash and the entry index),
+* so that a lookup seldom leaves the slot array. The entries themselves, key and value,
+* are kept in insertion order in one array.
+* Keys are string_views: those inside the stable buffer given to the constructor (the input)
+* are kept as they are, any other key is copied once, when inserted, into an arena of blocks,
+* small at first, as a table may only ever get a few such keys (e.g. a level of RepeatFinder's families).
+* So inserting a window of the input does not allocate, apart from the arrays growing now and then.
+* References to the values stay valid until the next insertion.
+*/
+template <typename Value>
+class SequenceTable
+{
+public:
+	using Entry = pair<string_view, Value>;
+
+	explicit SequenceTable(string_view stable = string_view())
+		: stable(stable)
+	{
+	}
+
+	static uint64_t Hash(string_view key) {
+		uint64_t hash = 0;
+		for (auto c : key) {
+			hash = hash * RollingHash::base + (unsigned char)c;
+		}
+		return hash;
+	}
+
+	Value& operator[](string_view key) {
+		return FindOrAdd(key, Hash(key));
+	}
+
+	// The value of key, added if not there yet; hash is Hash(key).
+	Value& FindOrAdd(string_view key, uint64_t hash) {
+		auto mixed = Mix(hash);
+		auto found = Locate(key, mixed);
+		if (found != nullptr) {
+			return *found;
+		}
+		if ((entries.size() + 1) * 8 > slots.size() * 7) {
+			Grow();
+		}
+		entries.emplace_back(Intern(key), Value());
+		hashes.push_back(mixed);
+		Place({ mixed, (uint32_t)entries.size() });
+		return entries.back().second;
+	}
+
+	Value* Find(string_view key) {
+		return Find(key, Hash(key));
+	}
+	Value* Find(string_view key, uint64_t hash) {
+		return Locate(key, Mix(hash));
+	}
+
+	size_t Size() const {
+		return entries.size();
+	}
+	bool Empty() const {
+		return entries.empty();
+	}
+
+	// Empty, but keeps the slots and the first block of the arena for the next use.
+	void Clear() {
+		fill(slots.begin(), slots.end(), Slot{ 0, 0 });
+		entries.clear();
+		hashes.clear();
+		if (blocks.size() > 1) {
+			blocks.resize(1);
+		}
+		block_bytes = first_block;
+		block_next = blocks.empty() ? nullptr : blocks.front().get();
+		block_left = first_block;
+	}
+
+	// Keep only the entries for which keep(entry) is true, in the same order.
+	template <typename Keep>
+	void Retain(Keep keep) {
+		size_t kept = 0;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (!keep(entries[i])) {
+				continue;
+			}
+			if (kept != i) {
+				entries[kept] = move(entries[i]);
+				hashes[kept] = hashes[i];
+			}
+			++kept;
+		}
+		entries.resize(kept);
+		hashes.resize(kept);
+		fill(slots.begin(), slots.end(), Slot{ 0, 0 });
+		for (size_t i = 0; i < entries.size(); ++i) {
+			Place({ hashes[i], (uint32_t)(i + 1) });
+		}
+	}
+
+	typename vector<Entry>::iterator begin() {
+		return entries.begin();
+	}
+	typename vector<Entry>::iterator end() {
+		return entries.end();
+	}
+	typename vector<Entry>::const_iterator begin() const {
+		return entries.begin();
+	}
+	typename vector<Entry>::const_iterator end() const {
+		return entries.end();
+	}
+
+	// Memory taken by the table, without what the values own.
+	size_t Bytes() const {
+		return slots.capacity() * sizeof(Slot) + entries.capacity() * sizeof(Entry)
+			+ hashes.capacity() * sizeof(uint32_t) + block_bytes;
+	}
+
+private:
+	static const size_t small_block_size = 1 << 12; // the first block; every next one is twice as large
+	static const size_t block_size = 1 << 20; // up to this
+
+	struct Slot
+	{
+		uint32_t hash;
+		uint32_t entry; // index + 1; 0 means empty
+	};
+
+	string_view stable;
+	vector<Slot> slots; // a power of 2 of them
+	vector<Entry> entries;
+	vector<uint32_t> hashes; // of the entries, for rebuilding the slots
+
+	vector<unique_ptr<char[]>> blocks; // the arena, for keys outside stable
+	size_t first_block = 0; // size of the first block
+	size_t block_bytes = 0; // of all the blocks
+	char* block_next = nullptr;
+	size_t block_left = 0;
+
+	// The polynomial hash is weak in its low bits; the slots get a thorough mix (splitmix64).
+	static uint32_t Mix(uint64_t hash) {
+		hash ^= hash >> 30;
+		hash *= 0xBF58476D1CE4E5B9ULL;
+		hash ^= hash >> 27;
+		hash *= 0x94D049BB133111EBULL;
+		hash ^= hash >> 31;
+		return (uint32_t)hash;
+	}
+
+	size_t Mask() const {
+		return slots.size() - 1;
+	}
+
+	// How far the slot at i is from where its hash would put it.
+	size_t Distance(const Slot& slot, size_t i) const {
+		return (i - (slot.hash & Mask())) & Mask();
+	}
+
+	Value* Locate(string_view key, uint32_t mixed) {
+		if (slots.empty()) {
+			return nullptr;
+		}
+		for (size_t i = mixed & Mask(), distance = 0; ; i = (i + 1) & Mask(), ++distance) {
+			auto& slot = slots[i];
+			if (slot.entry == 0 || Distance(slot, i) < distance) {
+				return nullptr;
+			}
+			if (slot.hash == mixed && entries[slot.entry - 1].first == key) {
+				return &entries[slot.entry - 1].second;
+			}
+		}
+	}
+
+	// Robin Hood: the new slot takes the place of any that is closer to its own place, which moves on.
+	void Place(Slot carried) {
+		for (size_t i = carried.hash & Mask(), distance = 0; ; i = (i + 1) & Mask(), ++distance) {
+			auto& slot = slots[i];
+			if (slot.entry == 0) {
+				slot = carried;
+				return;
+			}
+			auto slot_distance = Distance(slot, i);
+			if (slot_distance < distance) {
+				swap(slot, carried);
+				distance = slot_distance;
+			}
+		}
+	}
+
+	void Grow() {
+		slots.assign(max((size_t)16, slots.size() * 2), Slot{ 0, 0 });
+		for (size_t i = 0; i < entries.size(); ++i) {
+			Place({ hashes[i], (uint32_t)(i + 1) });
+		}
+	}
+
+	string_view Intern(string_view key) {
+		if (key.empty() || (key.data() >= stable.data() && key.data() + key.size() <= stable.data() + stable.size())) {
+			return key;
+		}
+		if (key.size() > block_left) {
+			auto size = max(min(block_size, small_block_size << min(blocks.size(), (size_t)8)), key.size());
+			blocks.push_back(make_unique<char[]>(size));
+			if (blocks.size() == 1) {
+				first_block = size;
+			}
+			block_bytes += size;
+			block_next = blocks.back().get();
+			block_left = size;
+		}
+		memcpy(block_next, key.data(), key.size());
+		string_view kept(block_next, key.size());
+		block_next += key.size();
+		block_left -= key.size();
+		return kept;
+	}
+};
@@ -0,0 +1,250 @@
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+#include "ShardFile.h"
+#include "ResultFile.h"
+#include "RepeatOutputs.h"
+#include "TextOutput.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+static const char shard_magic[4] = { 'T', '2', '4', 'S' };
+static const uint32_t shard_version = 1;
+
+int shard_of(string_view seq, int shards)
+{
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (auto c : seq) {
+		h ^= (unsigned char)c;
+		h *= 0x100000001B3ULL;
+	}
+	return (int)(h % (uint64_t)shards);
+}
+
+string shard_file_name(Config config, Process_Type pt, string filename, int shard)
+{
+	string prefix = pt == Process_Type::fpt ? "fpt_" : "crd_";
+	auto output_filename = prefix + output_basename(config, filename)
+		+ ".shard" + to_string(shard) + "of" + to_string(config.shards) + ".t24s";
+	return (fs::path(config.output_folder_name) /= output_filename).string();
+}
+
+string shard_log_name(Config config, int shard)
+{
+	return (fs::path(config.output_folder_name) /= "shard" + to_string(shard) + ".log").string();
+}
+
+void remove_shard_logs(Config config)
+{
+	for (int shard = 0; shard < config.shards; ++shard) {
+		error_code ec;
+		fs::remove(shard_log_name(config, shard), ec);
+	}
+}
+
+vector<ShardEntry> family_entries(const RepeatFinder& finder)
+{
+	vector<ShardEntry> entries;
+	for (auto const& [seq_length, level] : finder.Families()) {
+		for (auto const& [seq, positions] : level) {
+			for (auto start : positions) {
+				entries.push_back({ (uint64_t)start, (uint64_t)seq_length });
+			}
+		}
+	}
+	sort(entries.begin(), entries.end(), [](const ShardEntry& a, const ShardEntry& b) {
+		return a.length < b.length || (a.length == b.length && a.start < b.start);
+	});
+	return entries;
+}
+
+void write_shard_file(Config config, Process_Type pt, const FastaFile& input, const RepeatFinder& finder)
+{
+	auto output_filename = shard_file_name(config, pt, input.filename, config.shard);
+	std::cout << "Generating " << output_filename << "...";
+
+	auto entries = family_entries(finder);
+
+	auto& statistics = finder.Statistics();
+	ShardHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, shard_magic, sizeof(header.magic));
+	header.version = shard_version;
+	header.process_type = (uint32_t)pt;
+	header.shard = config.shard;
+	header.shards = config.shards;
+	header.copy_number = pt == Process_Type::fpt ? config.fpt_copy_number : config.crd_copy_number;
+	header.min_repeat_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	header.sequence_size = input.sequence.size();
+	header.meaningful_letters = statistics.meaningful_letters;
+	header.windows = statistics.windows;
+	header.entry_count = entries.size();
+	header.sequence_checksum = crc32(input.sequence.data(), input.sequence.size());
+	header.entries_checksum = crc32(entries.data(), entries.size() * sizeof(ShardEntry));
+	header.header_checksum = crc32(&header, offsetof(ShardHeader, header_checksum));
+
+	ensure_output_folder(config);
+	ofstream os(output_filename, ios::binary | ios::trunc);
+	if (!os) {
+		Error().Fatal("Cannot open for writing file: " + output_filename);
+	}
+	os.write((const char*)&header, sizeof(header));
+	os.write((const char*)entries.data(), entries.size() * sizeof(ShardEntry));
+	os.close();
+	if (!os) {
+		Error().Fatal("Cannot write file: " + output_filename);
+	}
+
+	std::cout << endl;
+}
+
+// Read one shard file and check it against config and the input.
+static vector<ShardEntry> read_shard_file(Config config, Process_Type pt, const FastaFile& input, int shard,
+	ShardHeader& header)
+{
+	auto filename = shard_file_name(config, pt, input.filename, shard);
+	ifstream is(filename, ios::binary);
+	if (!is) {
+		Error().Fatal("Cannot open for reading file: " + filename + " (has shard " + to_string(shard) + " finished?)");
+	}
+
+	is.read((char*)&header, sizeof(header));
+	if (!is || memcmp(header.magic, shard_magic, sizeof(shard_magic)) != 0) {
+		Error().Fatal("Not a shard file: " + filename);
+	}
+	if (header.version != shard_version) {
+		Error().Fatal("Unsupported shard file version " + to_string(header.version) + ": " + filename);
+	}
+	if (header.header_checksum != crc32(&header, offsetof(ShardHeader, header_checksum))) {
+		Error().Fatal("Header checksum mismatch: " + filename);
+	}
+
+	auto min_repeat_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	auto copy_number = pt == Process_Type::fpt ? config.fpt_copy_number : config.crd_copy_number;
+	if (header.process_type != (uint32_t)pt || header.shard != (uint32_t)shard || header.shards != (uint32_t)config.shards
+		|| header.min_repeat_length != (uint64_t)min_repeat_length || header.copy_number != copy_number) {
+		Error().Fatal("Shard file written with another configuration: " + filename);
+	}
+	if (header.sequence_size != input.sequence.size()
+		|| header.sequence_checksum != crc32(input.sequence.data(), input.sequence.size())) {
+		Error().Fatal("Shard file written for another input: " + filename);
+	}
+
+	vector<ShardEntry> entries((size_t)header.entry_count);
+	is.read((char*)entries.data(), entries.size() * sizeof(ShardEntry));
+	if (!is || header.entries_checksum != crc32(entries.data(), entries.size() * sizeof(ShardEntry))) {
+		Error().Fatal("Shard file is incomplete or damaged: " + filename);
+	}
+	return entries;
+}
+
+void merge_shards(Config config, Process_Type pt, const FastaFile& input)
+{
+	auto filename = input.filename;
+	std::cout << endl << "-- -- -- -- -- --\nInput file " << filename
+		<< ", merging " << config.shards << " shards" << endl;
+
+	config.absolute_origin = input.absolute_origin;
+
+	if (config.shards < 1) {
+		Error().Fatal("No shards to merge for " + filename);
+	}
+
+	auto stopwatch_start = chrono::high_resolution_clock::now();
+
+	vector<vector<ShardEntry>> shard_entries(config.shards);
+	ShardHeader first_header = {};
+	for (int shard = 0; shard < config.shards; ++shard) {
+		ShardHeader header;
+		shard_entries[shard] = read_shard_file(config, pt, input, shard, header);
+		if (shard == 0) {
+			first_header = header;
+		}
+		else if (header.meaningful_letters != first_header.meaningful_letters || header.windows != first_header.windows) {
+			Error().Fatal("Shard " + to_string(shard) + " does not agree with shard 0 on " + filename);
+		}
+	}
+
+	// Merge the sorted entries of all the shards, by length then start.
+	auto later = [&](const pair<size_t, int>& a, const pair<size_t, int>& b) {
+		auto& x = shard_entries[a.second][a.first];
+		auto& y = shard_entries[b.second][b.first];
+		return x.length > y.length || (x.length == y.length && x.start > y.start);
+	};
+	priority_queue<pair<size_t, int>, vector<pair<size_t, int>>, decltype(later)> next(later); // index, shard
+	for (int shard = 0; shard < config.shards; ++shard) {
+		if (!shard_entries[shard].empty()) {
+			next.push({ 0, shard });
+		}
+	}
+
+	auto min_repeat_length = pt == Process_Type::fpt ? config.fpt_min_repeat_length : config.crd_min_repeat_length;
+	FamilyLevels families;
+	ShardEntry previous = { UINT64_MAX, 0 };
+	while (!next.empty()) {
+		auto [index, shard] = next.top();
+		next.pop();
+		auto& entry = shard_entries[shard][index];
+		if (entry.start == previous.start && entry.length == previous.length) {
+			Error().Fatal("Shards overlap at position " + to_string(entry.start) + " on " + filename);
+		}
+		if (entry.start + entry.length > input.sequence.size()) {
+			Error().Fatal("Shard " + to_string(shard) + " has a repeat past the end of " + filename);
+		}
+		previous = entry;
+
+		// The first phase registers a sequence at the position right before it.
+		auto shift = (streamsize)entry.length == min_repeat_length ? 1 : 0;
+		level_of(families, (streamsize)entry.length, input.sequence)
+			[string_view(input.sequence).substr((size_t)entry.start + shift, (size_t)entry.length)].Add((streamsize)entry.start);
+
+		if (index + 1 < shard_entries[shard].size()) {
+			next.push({ index + 1, shard });
+		}
+	}
+	shard_entries.clear();
+
+	RepeatStatistics statistics;
+	statistics.meaningful_letters = (size_t)first_header.meaningful_letters;
+	statistics.windows = first_header.windows;
+
+	RepeatFinder finder(config, pt);
+	ProgressReporter reporter(finder.progress, config.progress_interval,
+		filename + (pt == Process_Type::fpt ? " fpt" : " crd") + " merge");
+	RepeatOutputs outputs(config, pt, input);
+	outputs.Connect(finder);
+
+	finder.SetFamilies(input.sequence, move(families), statistics);
+	try {
+		finder.FinishFamilies();
+	}
+	catch (const Cancelled&) {
+		outputs.Discard();
+		throw;
+	}
+
+	outputs.Finish(finder.Statistics());
+
+	// Merged: the shard files are not needed any more.
+	for (int shard = 0; shard < config.shards; ++shard) {
+		error_code ec;
+		fs::remove(shard_file_name(config, pt, filename, shard), ec);
+	}
+
+	// Execution time.
+	auto stopwatch_finish = chrono::high_resolution_clock::now();
+	auto stopwatch_elapsed = stopwatch_finish - stopwatch_start;
+	auto milliseconds = (long)(stopwatch_elapsed.count() / 1000000);
+	auto seconds = (int)round(milliseconds / 1000.0);
+	std::cout << endl
+		<< "Merging took " << seconds << " seconds on file " << filename << endl;
+}
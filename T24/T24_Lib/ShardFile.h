@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+
+#include "Config.h"
+#include "FastaFile.h"
+#include "RepeatFinder.h"
+
+using namespace std;
+
+/*
+* Sharded runs, for inputs too large for one process.
+* Every family descends from a family of the minimum length, so the work on an input file
+* can be split by the sequences of the minimum length: shard_of() gives each of them
+* to one of config.shards processes. Every process reads the whole input file,
+* finds the families of its shard (RepeatFinder::FindFamilies) and writes them into a shard file.
+* Together, the shard files have all the families with their copy numbers,
+* and merge_shards() finishes the work as a single process would.
+* The processes only share the folder, so they may run on one computer or on several.
+* The shard files and logs are removed after a successful merge, and kept otherwise.
+*
+* Shard file (.t24s), little endian:
+*	header		ShardHeader
+*	entries		ShardEntry, sorted by length, then by start:
+*				the families of this shard, as in RepeatFinder::Families()
+*/
+
+// Which of the shards the sequence of the minimum length belongs to.
+// The same on every computer, unlike std::hash (FNV-1a).
+int shard_of(string_view seq, int shards);
+
+struct ShardHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t process_type; // Process_Type
+	uint32_t shard;
+	uint32_t shards;
+	uint32_t copy_number;
+	uint64_t min_repeat_length;
+	uint64_t sequence_size;
+	uint64_t meaningful_letters;
+	uint64_t windows;
+	uint64_t entry_count;
+	uint32_t sequence_checksum; // all the shards must have seen the same input
+	uint32_t entries_checksum;
+	uint32_t header_checksum; // of all the bytes above
+	uint32_t reserved;
+};
+
+struct ShardEntry
+{
+	uint64_t start;
+	uint64_t length;
+};
+
+// The families of finder, sorted by length, then by start.
+vector<ShardEntry> family_entries(const RepeatFinder& finder);
+
+// Output/{fpt_|crd_}{basename}.shard{shard}of{shards}.t24s
+string shard_file_name(Config config, Process_Type pt, string filename, int shard);
+
+// Output/shard{shard}.log, the output of a shard process started by T24_CPP.
+string shard_log_name(Config config, int shard);
+
+// Once every input file is merged: remove the logs of the shard processes, if any.
+void remove_shard_logs(Config config);
+
+// Write the families found by finder, for config.shard.
+void write_shard_file(Config config, Process_Type pt, const FastaFile& input, const RepeatFinder& finder);
+
+// Read the shard files of input, check that they fit together
+// and write the output files requested by config; the shard files are removed once they are.
+void merge_shards(Config config, Process_Type pt, const FastaFile& input);
@@ -0,0 +1,138 @@
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "SharedRepeats.h"
+#include "RepeatFinder.h"
+#include "Progress.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+// Between the files; control characters never get into a sequence, so it is never a letter of one.
+static const char file_separator = '\n';
+
+void find_shared_repeats(Config config, vector<FastaFile>& inputs)
+{
+	std::cout << endl << "-- -- -- -- -- --\nShared repeats of " << inputs.size() << " input files" << endl;
+
+	auto stopwatch_start = chrono::high_resolution_clock::now();
+
+	// All the sequences in one, and where each of them starts.
+	size_t total_size = 0;
+	for (auto const& input : inputs) {
+		total_size += input.sequence.size() + 1;
+	}
+	string sequence;
+	sequence.reserve(total_size);
+	vector<streamsize> file_start;
+	for (auto& input : inputs) {
+		if (!sequence.empty()) {
+			sequence += file_separator;
+		}
+		file_start.push_back((streamsize)sequence.size());
+		sequence += input.sequence;
+		string().swap(input.sequence);
+	}
+
+	auto output_coordinates_filename = (fs::path(config.output_folder_name) /= "shared_crd.gb").string();
+	auto output_copynumber_filename = (fs::path(config.output_folder_name) /= "shared_cop.tab").string();
+	ofstream of_crd(output_coordinates_filename);
+	if (!of_crd) {
+		Error().Fatal("Cannot open for writing file: " + output_coordinates_filename);
+	}
+	ofstream of_cop(output_copynumber_filename);
+	if (!of_cop) {
+		Error().Fatal("Cannot open for writing file: " + output_copynumber_filename);
+	}
+	of_crd << "LOCUS	Annotations" << endl;
+	of_crd << "UNIMARK	Annotations" << endl;
+	of_crd << "FEATURES	Location/Qualifiers" << endl;
+	of_cop << "sequence\ttotal";
+	for (auto const& input : inputs) {
+		of_cop << "\t" << input.filename;
+	}
+	of_cop << endl;
+
+	RepeatFinder finder(config, Process_Type::crd);
+	ProgressReporter reporter(finder.progress, config.progress_interval, "shared repeats");
+
+	size_t shared_families = 0;
+	vector<size_t> copies_per_file(inputs.size());
+	auto on_family = [&](const RepeatFamily& family) {
+		// The file of a copy is that of its last letter: a family of the minimum length
+		// starts at the position before its letters, see RepeatFinder::EmitFamilies().
+		auto length = (streamsize)family.sequence.length();
+		auto file_of = [&](streamsize position) {
+			return (size_t)(upper_bound(file_start.begin(), file_start.end(), position + length - 1) - file_start.begin() - 1);
+		};
+
+		fill(copies_per_file.begin(), copies_per_file.end(), 0);
+		for (auto position : family.positions) {
+			++copies_per_file[file_of(position)];
+		}
+		if (count_if(copies_per_file.begin(), copies_per_file.end(), [](size_t c) { return c > 0; }) < 2) {
+			return;
+		}
+		++shared_families;
+
+		// Reverse complement copies, if any, are marked as complement(file:start..end), as in the crd files.
+		of_crd << "repeat_region	join(";
+		size_t i = 0;
+		for (auto position : family.positions) {
+			bool reverse = i < family.reverse.size() && family.reverse[i];
+			auto file = file_of(position);
+			auto start = position - file_start[file];
+			if (i > 0) {
+				of_crd << ",";
+			}
+			if (reverse) {
+				of_crd << "complement(";
+			}
+			of_crd << inputs[file].filename << ":" << start << ".." << (start + length);
+			if (reverse) {
+				of_crd << ")";
+			}
+			++i;
+		}
+		of_crd << ")" << endl;
+
+		of_crd << "/repeat sequence:	" << family.sequence << endl;
+
+		of_cop << family.sequence << "\t" << family.positions.Size();
+		for (auto copies : copies_per_file) {
+			of_cop << "\t" << copies;
+		}
+		of_cop << endl;
+	};
+	if (config.please_cull_crd) {
+		finder.on_culled_family = on_family;
+	}
+	else {
+		finder.on_family = on_family;
+	}
+
+	try {
+		finder.Run(sequence);
+	}
+	catch (const Cancelled&) {
+		for (auto [of, output_filename] : { make_pair(&of_crd, output_coordinates_filename),
+			make_pair(&of_cop, output_copynumber_filename) }) {
+			of->close();
+			error_code ec;
+			fs::remove(output_filename, ec);
+		}
+		throw;
+	}
+	of_crd << "//" << endl;
+
+	auto stopwatch_finish = chrono::high_resolution_clock::now();
+	auto milliseconds = (long)((stopwatch_finish - stopwatch_start).count() / 1000000);
+	auto seconds = (int)round(milliseconds / 1000.0);
+	std::cout << endl << shared_families << " families shared by the input files in "
+		<< output_coordinates_filename << " and " << output_copynumber_filename << endl
+		<< "Task took " << seconds << " seconds" << endl;
+} // find_shared_repeats()
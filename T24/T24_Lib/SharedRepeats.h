@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "FastaFile.h"
+
+using namespace std;
+
+/*
+* The repeats shared by the input files (config.please_find_shared_repeats), in one run over all of them:
+* their sequences are put one after the other, with a separator that is not a meaningful letter in between,
+* so that no copy spans two files, and one RepeatFinder with the crd parameters finds the families of them all.
+* Comparing the files two by two would take a run per pair.
+* Every family with copies in two files or more goes to
+*	Output/shared_crd.gb, laid out as the crd files, its copies tagged by file:
+*		join(chr1.fa:100..120,complement(chr2.fa:5..25)), every copy from where a run
+*		on its file alone would have it, start..start + length as in TextOutput::WriteLocation();
+*	Output/shared_cop.tab, its copy numbers in total and per file, a column per file.
+* The families are culled as set by cull_crd.
+* The separator never gets into a family: the extension only adds meaningful letters.
+* The sequences of inputs are moved out into the one they are searched in.
+*/
+void find_shared_repeats(Config config, vector<FastaFile>& inputs);
@@ -0,0 +1,107 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "TargetRegions.h"
+#include "TextOutput.h"
+#include "Error.h"
+
+using namespace std;
+
+TargetRegions::TargetRegions(Config config, const FastaFile& input)
+{
+	auto chromosome = input.sequence_name;
+	if (chromosome.empty()) {
+		chromosome = output_basename(config, input.filename);
+	}
+	auto size = (streamsize)input.sequence.size();
+	config.absolute_origin = input.absolute_origin;
+	auto origin = config.zero_based_origin();
+
+	ifstream is(config.regions);
+	if (!is) {
+		Error().Fatal("Cannot read the regions file " + config.regions);
+	}
+	string line;
+	for (int line_number = 1; getline(is, line); ++line_number) {
+		if (config.is_whitespace(line) || line[0] == '#' || line.rfind("track", 0) == 0 || line.rfind("browser", 0) == 0) {
+			continue;
+		}
+		istringstream fields(line);
+		string chrom;
+		streamsize start, end;
+		if (!(fields >> chrom >> start >> end) || start < 0 || end < start) {
+			Error().Fatal("Cannot parse line " + to_string(line_number) + " of the regions file " + config.regions + ": " + line);
+		}
+		if (chrom != chromosome) {
+			continue;
+		}
+		start = max((streamsize)0, start - origin);
+		end = min(size, end - origin);
+		if (start < end) {
+			regions.push_back({ start, end });
+		}
+	}
+
+	Merge();
+}
+
+TargetRegions TargetRegions::Widened(streamsize letters) const
+{
+	TargetRegions widened;
+	for (auto const& region : regions) {
+		widened.regions.push_back({ max((streamsize)0, region.start - letters), region.end });
+	}
+	widened.Merge();
+	return widened;
+}
+
+void TargetRegions::Merge()
+{
+	sort(regions.begin(), regions.end(), [](const Region& a, const Region& b) { return a.start < b.start; });
+	vector<Region> merged;
+	for (auto const& region : regions) {
+		if (!merged.empty() && region.start <= merged.back().end) {
+			merged.back().end = max(merged.back().end, region.end);
+		}
+		else {
+			merged.push_back(region);
+		}
+	}
+	regions = move(merged);
+}
+
+streamsize TargetRegions::Letters() const
+{
+	streamsize letters = 0;
+	for (auto const& region : regions) {
+		letters += region.end - region.start;
+	}
+	return letters;
+}
+
+bool TargetRegions::Contains(streamsize position) const
+{
+	auto r = RegionAfter(position);
+	return r < regions.size() && regions[r].start <= position;
+}
+
+bool TargetRegions::ContainsAny(streamsize first, streamsize period, streamsize last) const
+{
+	for (auto r = RegionAfter(first); r < regions.size() && regions[r].start <= last; ++r) {
+		// The first of them in the region.
+		auto position = regions[r].start <= first ? first
+			: first + (regions[r].start - first + period - 1) / period * period;
+		if (position < regions[r].end && position <= last) {
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t TargetRegions::RegionAfter(streamsize position) const
+{
+	auto found = upper_bound(regions.begin(), regions.end(), position,
+		[](streamsize position, const Region& region) { return position < region.end; });
+	return (size_t)(found - regions.begin());
+}
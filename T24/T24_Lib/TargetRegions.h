@@ -0,0 +1,65 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ios>
+
+#include "Config.h"
+#include "FastaFile.h"
+
+using namespace std;
+
+/*
+* The target regions of an input file, from the BED file of config.regions:
+*	chrom	start	end	...
+* 0-based, end exclusive, in the coordinates of the chromosome; the columns after end are ignored,
+* as are the track, browser and # lines. The lines of a file are those of its sequence name
+* (else its basename, as in DensityTracks.h), in its own coordinates: the 0-based origin
+* of its range=chr:start-end taken off (see Config::zero_based_origin()),
+* clipped to the sequence, sorted and merged.
+*
+* A copy is in the regions when the position the finder registers it at is, see RepeatFinder:
+* only the families with such a copy are reported, with all their copies,
+* and only the footprints in the regions.
+*/
+class TargetRegions
+{
+public:
+	// [start, end)
+	struct Region
+	{
+		streamsize start;
+		streamsize end;
+	};
+
+	TargetRegions() = default;
+
+	// Fatal if the file cannot be read or a line cannot be parsed.
+	TargetRegions(Config config, const FastaFile& input);
+
+	// The same regions, each starting that many letters earlier.
+	TargetRegions Widened(streamsize letters) const;
+
+	const vector<Region>& Regions() const {
+		return regions;
+	}
+
+	bool Empty() const {
+		return regions.empty();
+	}
+
+	// Letters in the regions.
+	streamsize Letters() const;
+
+	bool Contains(streamsize position) const;
+
+	// Whether any of first, first + period, ..., last is in the regions.
+	bool ContainsAny(streamsize first, streamsize period, streamsize last) const;
+
+private:
+	vector<Region> regions; // sorted, not touching
+
+	// The first region that ends after position, regions.size() if none.
+	size_t RegionAfter(streamsize position) const;
+
+	void Merge();
+};
@@ -0,0 +1,80 @@
+#include <thread>
+#include <algorithm>
+
+#include "TaskPool.h"
+
+using namespace std;
+
+TaskPool::TaskPool(int threads)
+	: threads(threads)
+{
+	if (this->threads <= 0) {
+		this->threads = max(1, (int)thread::hardware_concurrency());
+	}
+	for (int i = 0; i < this->threads; ++i) {
+		queues.push_back(make_unique<Queue>());
+	}
+}
+
+void TaskPool::Submit(Task task, int worker)
+{
+	if (worker < 0) {
+		worker = (int)(next_queue++ % queues.size());
+	}
+	++pending;
+	auto& queue = *queues[worker];
+	lock_guard<mutex> lock(queue.guard);
+	queue.tasks.push_back(move(task));
+}
+
+bool TaskPool::Take(int worker, Task& task)
+{
+	// Own queue: newest first.
+	{
+		auto& queue = *queues[worker];
+		lock_guard<mutex> lock(queue.guard);
+		if (!queue.tasks.empty()) {
+			task = move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+	// Others: oldest first.
+	for (int i = 1; i < threads; ++i) {
+		auto& queue = *queues[(worker + i) % threads];
+		lock_guard<mutex> lock(queue.guard);
+		if (!queue.tasks.empty()) {
+			task = move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskPool::Work(int worker)
+{
+	Task task;
+	while (pending > 0) {
+		if (Take(worker, task)) {
+			task(worker);
+			task = nullptr;
+			--pending;
+		}
+		else {
+			this_thread::yield();
+		}
+	}
+}
+
+void TaskPool::Run()
+{
+	vector<thread> workers;
+	for (int i = 1; i < threads; ++i) {
+		workers.emplace_back(&TaskPool::Work, this, i);
+	}
+	Work(0);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+using namespace std;
+
+/*
+* A work-stealing pool of threads.
+* Every worker has its own queue: it takes its newest task first,
+* and when its queue is empty it steals the oldest task of another worker.
+* Tasks get the index of the worker running them, and submit their subtasks to it,
+* so that related work stays on one core until somebody runs out of work.
+*/
+class TaskPool
+{
+public:
+	using Task = function<void(int worker)>;
+
+	// threads <= 0 means one per hardware thread.
+	explicit TaskPool(int threads = 0);
+
+	int Threads() const {
+		return threads;
+	}
+
+	// From a task: to its worker's queue. From outside: spread over the workers.
+	void Submit(Task task, int worker = -1);
+
+	// Run all the tasks, including the ones they submit, and return when there are none left.
+	// The calling thread is worker 0.
+	void Run();
+
+private:
+	struct Queue
+	{
+		mutex guard;
+		deque<Task> tasks;
+	};
+
+	int threads;
+	vector<unique_ptr<Queue>> queues;
+	atomic<size_t> pending{ 0 }; // submitted and not finished
+	size_t next_queue = 0; // for the tasks submitted from outside
+
+	bool Take(int worker, Task& task);
+	void Work(int worker);
+};
@@ -0,0 +1,399 @@
+#include <filesystem>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+
+#include "TextOutput.h"
+#include "FastaFile.h"
+#include "InputReader.h"
+#include "Crc32.h"
+#include "Error.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+string summary_file_name(Config config) {
+	string output_summary_filename = "summary.tab"; // single file for the whole folder
+	output_summary_filename = (fs::path(config.output_folder_name) /= output_summary_filename)
+		.string();
+	return output_summary_filename;
+}
+
+void ensure_output_folder(Config config)
+{
+	auto output_folder_path = fs::path(config.output_folder_name);
+	if (fs::exists(output_folder_path)) {
+		if (!fs::is_directory(output_folder_path)) {
+			string msg = "***Output folder name clashes with an existing plain file name.";
+			Error().Fatal(msg);
+		}
+	}
+	else {
+		fs::create_directory(output_folder_path);
+	}
+}
+
+string summary_row_name(string filename)
+{
+	return filename == InputReader::standard_input ? "stdin" : filename;
+}
+
+string output_basename(Config config, string filename)
+{
+	if (filename == InputReader::standard_input) {
+		return "stdin";
+	}
+	// chr1.fa.gz is named as chr1.fa
+	if (is_gzip_file_name(filename)) {
+		filename = fs::path(filename).replace_extension().string();
+	}
+	auto basename = filename;
+	auto input_prefix = config.config_map[config.label_input_filename_prefix];
+	if (filename.find_first_of(input_prefix) == 0) {
+		basename = basename.substr(input_prefix.length());
+	}
+	auto extension = fs::path(filename).extension().string();
+	if (extension.length() > 0) {
+		basename = basename.substr(0, basename.length() - extension.length());
+	}
+	return basename;
+}
+
+TextOutput::TextOutput(Config config, Process_Type pt, string filename, string_view sequence)
+	: config(config), pt(pt), filename(filename), sequence(sequence)
+{
+	ensure_output_folder(config);
+
+	// Output filenames
+	auto basename = output_basename(config, filename);
+	output_footprint_filename = "fpt_" + basename + ".csv";
+	output_elements_filename = "e_" + basename + ".tab";
+	output_coordinates_filename = "crd_" + basename + ".gb";
+	output_all_coordinates_filename = "crd_all_" + basename + ".gb";
+	output_copynumber_filename = "cop_" + basename + ".mfa";
+	output_masked_filename = basename + "_srm.fa";
+
+	output_footprint_filename = (fs::path(config.output_folder_name) /= output_footprint_filename)
+		.string();
+	output_elements_filename = (fs::path(config.output_folder_name) /= output_elements_filename)
+		.string();
+	output_coordinates_filename = (fs::path(config.output_folder_name) /= output_coordinates_filename)
+		.string();
+	output_all_coordinates_filename = (fs::path(config.output_folder_name) /= output_all_coordinates_filename)
+		.string();
+	output_copynumber_filename = (fs::path(config.output_folder_name) /= output_copynumber_filename)
+		.string();
+	output_masked_filename = (fs::path(config.output_folder_name) /= output_masked_filename)
+		.string();
+
+	if (pt == Process_Type::fpt) {
+
+		// 1. Footprint output file and elements output file.
+		std::cout << "Generating " << output_footprint_filename << " and " << output_elements_filename << "..." << endl;
+
+		of_fpt.open(output_footprint_filename);
+		if (!of_fpt) {
+			Error().Fatal("Cannot open for writing file: " + output_footprint_filename);
+		}
+
+		of_elements.open(output_elements_filename);
+		if (!of_elements) {
+			Error().Fatal("Cannot open for writing file: " + output_elements_filename);
+		}
+
+		// Headers.
+		of_elements << "track type=wiggle_0 name=Ch0 Custom UM 00 U" << endl;
+		of_elements << "variablestep chrom=chr0" << endl;
+	}
+
+	if (pt == Process_Type::crd) {
+
+		// 1. Coordinates file.
+		std::cout << "Generating " << output_coordinates_filename << "..." << endl;
+
+		of_crd.open(output_coordinates_filename);
+		if (!of_crd) {
+			Error().Fatal("Cannot open for writing file: " + output_coordinates_filename);
+		}
+
+		// Print the families in GB format.
+		of_crd << "LOCUS	Annotations" << endl;
+		of_crd << "UNIMARK	Annotations" << endl;
+		of_crd << "FEATURES	Location/Qualifiers" << endl;
+
+		// 2. All the positions of the capped families.
+		if (config.crd_max_positions > 0 && config.please_create_crd_all_file) {
+			std::cout << "Generating " << output_all_coordinates_filename << "..." << endl;
+
+			of_crd_all.open(output_all_coordinates_filename);
+			if (!of_crd_all) {
+				Error().Fatal("Cannot open for writing file: " + output_all_coordinates_filename);
+			}
+
+			of_crd_all << "LOCUS	Annotations" << endl;
+			of_crd_all << "UNIMARK	Annotations" << endl;
+			of_crd_all << "FEATURES	Location/Qualifiers" << endl;
+		}
+	}
+}
+
+void TextOutput::AddFamily(const RepeatFamily& family)
+{
+	if (pt != Process_Type::crd) {
+		return;
+	}
+
+	AddCopyNumber(family.sequence, (int)family.positions.Size());
+
+	if (!config.please_cull_crd) {
+		WriteCoordinates(family);
+	}
+}
+
+void TextOutput::AddCopyNumber(const string& sequence, int count)
+{
+	// Goal for the copy number file: sort by seq count then by length.
+	// Use the original (not culled) data.
+	count2seqs[count].push_back(sequence);
+}
+
+void TextOutput::AddCulledFamily(const RepeatFamily& family)
+{
+	if (pt != Process_Type::crd || !config.please_cull_crd) {
+		return;
+	}
+
+	WriteCoordinates(family);
+}
+
+void TextOutput::AddIsland(const Island& island)
+{
+	if (pt != Process_Type::fpt) {
+		return;
+	}
+
+	island_count++;
+	size_t start = island.start + config.shift_coordinates;
+	size_t end = island.end + config.shift_coordinates;
+	of_fpt << "island" << island_count << "," << start << "," << end << endl;
+	// masked
+	if (config.please_create_masked_file) {
+		island_endpoints.push_back(start);
+		island_endpoints.push_back(end);
+	}
+	// elements
+	auto e = config.absolute_origin + (end + start) / 2;
+	of_elements << e << endl;
+}
+
+void TextOutput::Discard()
+{
+	for (auto [of, output_filename] : { make_pair(&of_fpt, output_footprint_filename),
+		make_pair(&of_elements, output_elements_filename), make_pair(&of_crd, output_coordinates_filename),
+		make_pair(&of_crd_all, output_all_coordinates_filename) }) {
+		if (of->is_open()) {
+			of->close();
+			error_code ec;
+			fs::remove(output_filename, ec);
+		}
+	}
+}
+
+void TextOutput::Finish(const RepeatStatistics& statistics)
+{
+	if (pt == Process_Type::fpt) {
+		of_elements.close();
+		of_fpt.close();
+
+		std::cout << endl;
+
+		// 2. Summary file.
+		auto output_summary_filename = summary_file_name(config);
+		ofstream of_sum(output_summary_filename, ios::app);
+		if (!of_sum) {
+			Error().Fatal("Cannot open for writing file: " + output_summary_filename);
+		}
+
+		of_sum.setf(ios::fixed, ios::floatfield);
+		of_sum << summary_row_name(filename) << "\t" << setprecision(4) << statistics.density_percent() << "%"
+			<< "\t" << statistics.subdensity_percent() << "%"
+			<< endl;
+		of_sum.close();
+
+		std::cout << endl;
+
+		// 3. Masked (srm) file.
+		if (config.please_create_masked_file) {
+			WriteMasked();
+		}
+	}
+
+	if (pt == Process_Type::crd) {
+		of_crd << "//" << endl;
+		of_crd.close();
+		if (of_crd_all.is_open()) {
+			of_crd_all << "//" << endl;
+			of_crd_all.close();
+		}
+
+		std::cout << endl;
+
+		// 2. Copy number file.
+		WriteCopyNumbers();
+	}
+}
+
+void TextOutput::WriteCoordinates(const RepeatFamily& family)
+{
+	auto& seq = family.sequence;
+	auto& li = family.positions;
+	if (li.Empty()) return;
+
+	auto capped = config.crd_max_positions > 0 && li.Size() > (size_t)config.crd_max_positions;
+	WriteLocation(of_crd, family, capped ? ShownPositions(family) : vector<size_t>());
+	of_crd << "/repeat sequence:	" << seq << endl;
+	if (!capped) {
+		return;
+	}
+
+	// The exact count, and which of the copies are shown.
+	of_crd << "/copy number:	" << li.Size() << endl;
+	of_crd << "/positions shown:	" << (config.please_sample_crd_positions ? "random " : "first ")
+		<< config.crd_max_positions << endl;
+
+	if (of_crd_all.is_open()) {
+		WriteLocation(of_crd_all, family, vector<size_t>());
+		of_crd_all << "/repeat sequence:	" << seq << endl;
+	}
+}
+
+void TextOutput::WriteLocation(ofstream& of, const RepeatFamily& family, const vector<size_t>& shown)
+{
+	// Reverse complement copies, if any, are marked as complement(start..end).
+	// shown: the indexes of the positions to write, in increasing order; all of them if empty.
+	auto length = family.sequence.length();
+	of << "repeat_region	join(";
+	size_t i = 0;
+	size_t next = 0; // in shown
+	for (auto position : family.positions) {
+		if (!shown.empty()) {
+			if (next == shown.size()) {
+				break;
+			}
+			if (shown[next] != i) {
+				++i;
+				continue;
+			}
+			++next;
+		}
+		bool reverse = i < family.reverse.size() && family.reverse[i];
+		if (shown.empty() ? i > 0 : next > 1) {
+			of << ",";
+		}
+		if (reverse) {
+			of << "complement(";
+		}
+		of << position << ".." << (position + length);
+		if (reverse) {
+			of << ")";
+		}
+		++i;
+	}
+	of << ")" << endl;
+}
+
+vector<size_t> TextOutput::ShownPositions(const RepeatFamily& family)
+{
+	auto max_positions = (size_t)config.crd_max_positions;
+	vector<size_t> shown;
+	shown.reserve(max_positions);
+	if (!config.please_sample_crd_positions) {
+		for (size_t i = 0; i < max_positions; ++i) {
+			shown.push_back(i);
+		}
+		return shown;
+	}
+
+	// A reservoir sample, seeded by the sequence: the same family gets the same copies
+	// from run to run, whatever the order of the families.
+	// The modulo rather than a distribution, whose results differ between libraries.
+	mt19937_64 random_bits(crc32(family.sequence.data(), family.sequence.size()));
+	for (size_t i = 0; i < family.positions.Size(); ++i) {
+		if (i < max_positions) {
+			shown.push_back(i);
+			continue;
+		}
+		auto j = (size_t)(random_bits() % (i + 1));
+		if (j < max_positions) {
+			shown[j] = i;
+		}
+	}
+	sort(shown.begin(), shown.end());
+	return shown;
+}
+
+void TextOutput::WriteMasked()
+{
+	std::cout << "Generating " << output_masked_filename << "...";
+
+	ofstream of_srm(output_masked_filename);
+	if (!of_srm) {
+		Error().Fatal("Cannot open for writing file: " + output_masked_filename);
+	}
+
+	// Note: each island is inclusive on left, exclusive on right side.
+	bool in_island = false;
+	size_t island_x = 0; // index of the next island endpoint, if any (negative if none)
+	for (streamsize pos = 0; pos < (streamsize)sequence.size(); pos++)
+	{
+		if (island_x < island_endpoints.size()) {
+			if (island_endpoints[island_x] == pos) {
+				if (in_island) {
+					// finish the island
+					in_island = false;
+				}
+				else {
+					// start the island
+					in_island = true;
+				}
+				// next endpoint
+				++island_x;
+			}
+		}
+
+		if (in_island) {
+			of_srm << config.masking_character;
+		}
+		else {
+			of_srm << sequence[pos];
+		}
+	} // for pos
+	of_srm.close();
+
+	std::cout << endl;
+}
+
+void TextOutput::WriteCopyNumbers()
+{
+	std::cout << "Generating " << output_copynumber_filename << "...";
+
+	ofstream of_cop(output_copynumber_filename);
+	if (!of_cop) {
+		Error().Fatal("Cannot open for writing file: " + output_copynumber_filename);
+	}
+
+	// Now count2seqs has, for each count, sequences that appear that number of times,
+	// in a non-decreasing order of their lengths.
+	for (auto itr = count2seqs.crbegin(); itr != count2seqs.crend(); ++itr) {
+		auto count = itr->first;
+		auto& seqs = itr->second;
+		for (auto itrseq = seqs.crbegin(); itrseq != seqs.crend(); ++itrseq) {
+			auto& seq = *itrseq;
+
+			of_cop << ">" << count << endl << seq << endl;
+		}
+	}
+	of_cop.close();
+
+	std::cout << endl;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include "Config.h"
+#include "RepeatFinder.h"
+
+using namespace std;
+
+/*
+* Auxiliary.
+*/
+string summary_file_name(Config config);
+
+// Make sure the output folder exists.
+void ensure_output_folder(Config config);
+
+// Input filename as written in summary.tab: "stdin" for the standard input, as in output_basename().
+string summary_row_name(string filename);
+
+// Input filename without config's input prefix and without the extension, .gz included;
+// "stdin" for the standard input.
+string output_basename(Config config, string filename);
+
+/*
+* The text output files of one process type for one input file.
+* As part of the footprint processing, generate:
+*	- The footpring file, one per input file, which is a csv file with islands counted and island end points marked.
+*	- The elements file e_{filename}.tab with island midpoints.
+*	- Summary file summary.tab, one per the whole folder, with footprint densities.
+*	- The masked file {filename}_srm.fa, if so requested.
+* As part of the coordinates processing, generate:
+*	- The coordinates file crd_{filename}.gb, with at most config.crd_max_positions positions per family,
+*	  if set, and all the positions of the families above it in crd_all_{filename}.gb, if so requested.
+*	- The copy number output file cop_{filename}.mfa
+* Files are opened by the constructor, written to as the results come in,
+* and completed by Finish().
+*/
+class TextOutput
+{
+public:
+	TextOutput(Config config, Process_Type pt, string filename, string_view sequence);
+
+	// Whether AddFamily(), AddCulledFamily(), AddIsland() are needed at all.
+	bool NeedsFamilies() const {
+		return pt == Process_Type::crd;
+	}
+	bool NeedsCulledFamilies() const {
+		return pt == Process_Type::crd && config.please_cull_crd;
+	}
+	bool NeedsIslands() const {
+		return pt == Process_Type::fpt;
+	}
+
+	void AddFamily(const RepeatFamily& family); // before culling
+	void AddCopyNumber(const string& sequence, int count); // part of AddFamily()
+	void AddCulledFamily(const RepeatFamily& family);
+	void AddIsland(const Island& island);
+	void Finish(const RepeatStatistics& statistics);
+
+	// Instead of Finish(), for a cancelled run: remove the files written so far.
+	void Discard();
+
+private:
+	Config config;
+	Process_Type pt;
+	string filename;
+	string_view sequence;
+
+	string output_footprint_filename;
+	string output_elements_filename;
+	string output_coordinates_filename;
+	string output_all_coordinates_filename;
+	string output_copynumber_filename;
+	string output_masked_filename;
+
+	ofstream of_fpt;
+	ofstream of_elements;
+	ofstream of_crd;
+	ofstream of_crd_all;
+
+	int island_count = 0;
+	vector<streamsize> island_endpoints; // start, then end, of each island, in order
+	map<int, vector<string>> count2seqs; // count => seqs, ordered by count
+
+	void WriteCoordinates(const RepeatFamily& family);
+	void WriteLocation(ofstream& of, const RepeatFamily& family, const vector<size_t>& shown);
+	vector<size_t> ShownPositions(const RepeatFamily& family);
+	void WriteMasked();
+	void WriteCopyNumbers();
+};
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "Error.h"
+#include "Config.h"
+#include "FastaFile.h"
+#include "TextOutput.h"
+#include "ShardFile.h"
+#include "Progress.h"
+
+using namespace std;
+namespace fs = filesystem;
+
+/*
+* Put together the shard files of a sharded run (see ShardFile.h)
+* and write the usual output files, as T24_CPP would have.
+* For shards run by hand, e.g. on several computers sharing this folder:
+*	T24_CPP shard=0, ..., T24_CPP shard=S-1, then T24_Merge
+* with shards=S in the config. T24_CPP alone does all of it on one computer.
+*/
+int main()
+{
+	auto folder_current_path = fs::current_path();
+	Config config;
+	config.Parse();
+
+	cancel_on_interrupt();
+
+	try {
+		if (config.shards <= 1) {
+			Error().Fatal("Nothing to merge: the config has no shards=S with S > 1.");
+		}
+
+		ensure_output_folder(config);
+
+		// Pre-create the summary file, one for the whole folder.
+		auto output_summary_filename = summary_file_name(config);
+		ofstream of_sum(output_summary_filename, ios::trunc);
+		if (!of_sum) {
+			Error().Fatal("Cannot open for writing file: " + output_summary_filename);
+		}
+
+		for (const auto& entry : fs::directory_iterator(folder_current_path)) {
+			auto filename = entry.path().filename().string();
+			if (!is_fasta_file_name(filename)) {
+				continue;
+			}
+
+			FastaFile input;
+			input.Load(filename);
+
+			if (config.please_create_fpt_file) {
+				merge_shards(config, Process_Type::fpt, input);
+			}
+			if (config.please_create_crd_file) {
+				merge_shards(config, Process_Type::crd, input);
+			}
+		}
+
+		remove_shard_logs(config);
+	}
+	catch (const Cancelled&) {
+		std::cerr << endl << "Cancelled; the output files of the unfinished input file were removed." << endl;
+		return 1;
+	}
+	catch (const exception* ex) {
+		// Error().Fatal() throws a pointer.
+		std::cerr << ex->what() << endl;
+		delete ex;
+		return 1;
+	}
+	catch (const exception& ex) {
+		std::cerr << ex.what();
+		return 1;
+	}
+}
@@ -2,10 +2,14 @@
 #include <fstream>
 #include <filesystem>
 #include <regex>
+#include <vector>
+#include <algorithm>
 
 #include "Util.h"
 #include "Error.h"
 #include "Config.h"
+#include "InputReader.h"
+#include "PackedFasta.h"
 
 using namespace std;
 namespace fs = filesystem;
@@ -27,41 +31,23 @@ regex create_regex_from_config____(Config config)
 	return reGappedTandem;
 }
 
-char* create_from_legit_letters(ifstream& is, size_t filesize, size_t& actual_size)
+string create_from_legit_letters(InputReader& is)
 {
-	// Remember where the data starts.
-	auto stream_start_data = is.tellg();
-
-	// Full buffer will contain all the data from the file.
-	size_t fullbuffer_capacity = (size_t)(filesize - stream_start_data);
-	actual_size = 0; // fullbuffer_capacity minus the number of control characters
-	auto fullbuffer = new char[fullbuffer_capacity]; // only fullbuffer_size will be used
-
-	size_t buffer_capacity = 8; // 8192;
-	char* buffer = new char[buffer_capacity];
-
-	char* pch = fullbuffer;
-	for (; !is.eof();) {
-		auto read_this_many = buffer_capacity;
-		is.read(buffer, read_this_many);
-		if (is.eof()) {
-			read_this_many = is.gcount();
-		}
-
-		actual_size += read_this_many;
-		for (size_t i = 0; i < read_this_many; ++i) {
-			auto ch = buffer[i];
+	// Full buffer will contain all the letters from the file.
+	// It grows block by block, since a compressed or piped input has no size to go by.
+	string fullbuffer;
+	fullbuffer.reserve(is.SizeHint());
+
+	string block;
+	while (is.Next(block)) {
+		for (auto ch : block) {
 			if (!isalpha(ch)) {
-				--actual_size;
 				continue;
 			}
-			*pch = ch;
-			++pch;
+			fullbuffer.push_back(ch);
 		}
 	}
 
-	delete[] buffer;
-
 	return fullbuffer;
 }
 
@@ -70,33 +56,43 @@ void process_file(string filename)
 	Config config;
 	config.Parse();
 
-	ifstream is(filename);
-	if (!is) {
-		Error().Fatal("Cannot open for reading file: " + filename);
-	}
-
 	cout << endl << "Input file: " << filename << endl;
 
 	// Execution time.
 	auto stopwatch_start = chrono::high_resolution_clock::now();
 
-	// Skip/remember the header if any.
-	string inputline, header;
-	while (is.peek() == '>' && getline(is, inputline)) {
-		header += inputline;
-		// TODO: is origin_shift relevant?
+	string header, fullbuffer;
+	if (is_packed_file_name(filename)) {
+		// A FASTA file as packed by T24_CPP, reloaded without parsing.
+		PackedFasta packed;
+		packed.Open(filename);
+		header = packed.FastaHeader();
+		packed.Unpack(fullbuffer);
+		fullbuffer.erase(remove_if(fullbuffer.begin(), fullbuffer.end(),
+			[](char ch) { return !isalpha((unsigned char)ch); }), fullbuffer.end());
 	}
+	else {
+		// Plain or gzip, decompressed on the reader's thread while the letters are taken in here.
+		InputReader is(filename);
+
+		// Skip/remember the header if any.
+		string inputline;
+		while (is.HeaderLine(inputline)) {
+			header += inputline;
+			// TODO: is origin_shift relevant?
+		}
 
-	// Read in the rest of the file buffer by buffer
-	// while removing illegal letters/chars.
-	size_t fullbuffer_size;
-	auto fullbuffer = create_from_legit_letters(is, fs::file_size(filename), fullbuffer_size);
+		// Read in the rest of the file buffer by buffer
+		// while removing illegal letters/chars.
+		fullbuffer = create_from_legit_letters(is);
+	}
+	auto fullbuffer_size = fullbuffer.size();
 
 	regex re_tandem = create_regex_from_config(config);
 
 	int count_tandems = 0;
 	for (streamsize start_candidate = 0; start_candidate < fullbuffer_size; ++start_candidate) {
-		string candidate = string(fullbuffer + start_candidate, 12);
+		string candidate = fullbuffer.substr(start_candidate, 12);
 		if (regex_match(candidate, re_tandem)) {
 			++count_tandems;
 		}
@@ -117,11 +113,14 @@ void process_file(string filename)
 	auto seconds = (int)round(milliseconds / 1000.0);
 	std::cout << endl
 		<< "File " << filename << " took " << seconds << " seconds." << endl;
-
-	delete[] fullbuffer;
 }
 
-int main()
+/*
+* Usage: T32_CPP [file...]
+* Files given are processed instead of the FASTA files of the current folder (.fa, .fasta, either .gz);
+* "-" is the standard input; a .t24p file is reloaded as the FASTA file it was packed from.
+*/
+int main(int argc, char* argv[])
 {
 	cout << "GAPPED TANDEMS " << Util::TimestampCurrent() << endl;
 
@@ -132,15 +131,20 @@ int main()
 	auto stopwatch_start = chrono::high_resolution_clock::now();
 
 	// Read in only certain files in the given folder.
-	regex regex_fa(".+\\.(fa|fasta)", regex::icase); // describes input file names
-
-	// All the matching files:
-	for (const auto& entry : fs::directory_iterator(folder_input)) {
-		auto filename = entry.path().filename().string();
-		if (!regex_match(filename, regex_fa)) {
-			continue;
+	regex regex_fa(".+\\.(fa|fasta)(\\.gz)?", regex::icase); // describes input file names
+
+	// The files given, else all the matching files:
+	vector<string> filenames(argv + 1, argv + argc);
+	if (filenames.empty()) {
+		for (const auto& entry : fs::directory_iterator(folder_input)) {
+			auto filename = entry.path().filename().string();
+			if (regex_match(filename, regex_fa)) {
+				filenames.push_back(filename);
+			}
 		}
+	}
 
+	for (auto const& filename : filenames) {
 		// Work on a single file.
 		process_file(filename);
 	} // for each input data file